@@ -0,0 +1,396 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+/* A benchmark of syntax highlighting. For each file of a corpus, it measures
+   the time of highlighting the whole document, the time of formatting a
+   visible window, the latency of re-highlighting after a single-character
+   edit at the top of the document and the increase of the peak memory of
+   the process during the measurement (-1 if it can't be measured). The
+   number of regex compilations after the first pass is also reported; it
+   should be zero because the expressions of hot paths are precompiled. It's
+   -1 if compilations can't be counted (see pcre2_compile_16() below). The
+   corpus consists of generated texts and, optionally, of real files given
+   as arguments (files or directories). The results are written as JSON.
+
+   Usage: featherpad-benchmark [--lines N] [--output FILE] [FILE|DIR...] */
+
+#include <QGuiApplication>
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QTextBlock>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QAtomicInt>
+#include <stdio.h>
+#include <stdint.h>
+#if defined(__GLIBC__)
+#include <dlfcn.h>
+#endif
+#include "highlighter.h"
+
+using namespace FeatherPad;
+
+static const int VISIBLE_LINES = 50; // the number of lines in the visible window
+
+static QAtomicInt pcreCompilations;
+
+#if defined(__GLIBC__)
+/* QRegularExpression compiles its patterns with this PCRE2 function. When
+   Qt uses the system PCRE2 library, it calls the function of the benchmark
+   (which is linked with "-rdynamic"), so that every real compilation,
+   wherever it happens, is counted before the library function is called. */
+extern "C" void *pcre2_compile_16 (const uint16_t *pattern, size_t length, uint32_t options,
+                                   int *errorcode, size_t *erroroffset, void *ccontext)
+{
+    typedef void *(*CompileFunc) (const uint16_t*, size_t, uint32_t, int*, size_t*, void*);
+    static const CompileFunc compile = reinterpret_cast<CompileFunc>(dlsym (RTLD_NEXT, "pcre2_compile_16"));
+    pcreCompilations.ref();
+    return compile (pattern, length, options, errorcode, erroroffset, ccontext);
+}
+#endif
+/*************************/
+// Whether the real compilations are counted, i.e., a new pattern is counted.
+static bool compilationsCounted()
+{
+    static int counted = -1;
+    if (counted == -1)
+    {
+        const int n = pcreCompilations.load();
+        QRegularExpression probe (QStringLiteral ("featherpad-benchmark-probe"));
+        probe.match (QString()); // compiles the pattern
+        counted = pcreCompilations.load() > n ? 1 : 0;
+    }
+    return counted == 1;
+}
+
+struct Sample
+{
+    QString name;
+    QString lang;
+    QString text;
+};
+
+/*************************/
+// The peak resident memory of the process (in KiB), or -1 if it's unknown.
+static qint64 statusValue (const QByteArray &field)
+{
+    QFile file ("/proc/self/status");
+    if (!file.open (QIODevice::ReadOnly | QIODevice::Text))
+        return -1;
+    const QList<QByteArray> lines = file.readAll().split ('\n');
+    for (const QByteArray &line : lines)
+    {
+        if (line.startsWith (field))
+            return line.mid (field.size()).trimmed().split (' ').first().toLongLong();
+    }
+    return -1;
+}
+/*************************/
+// The peak memory of the process never goes down by itself. It's reset to the
+// current memory before each measurement (Linux 4.0 or later), and the increase
+// is reported. Returns false if the peak can't be reset.
+static bool resetPeakMemory()
+{
+    QFile file ("/proc/self/clear_refs");
+    if (!file.open (QIODevice::WriteOnly | QIODevice::Unbuffered))
+        return false;
+    return file.write ("5") == 1;
+}
+/*************************/
+static double msecs (const QElapsedTimer &timer)
+{
+    return static_cast<double>(timer.nsecsElapsed()) / 1000000.0;
+}
+/*************************/
+static QString generateCpp (int lines)
+{
+    QString text;
+    int i = 0;
+    while (i < lines)
+    {
+        text += QString ("/* Function number %1.\n"
+                         "   It returns a \"quoted\" value. */\n"
+                         "static int function%1 (const QString &str, int n) // comment\n"
+                         "{\n"
+                         "    if (str.isEmpty() || n < 0)\n"
+                         "        return -1;\n"
+                         "    QString s = \"value (%1) with \\\"escapes\\\"\";\n"
+                         "    for (int i = 0; i < n; ++i)\n"
+                         "        s += QString::number (i * 0x%1);\n"
+                         "    return s.size() + '\\n';\n"
+                         "}\n\n").arg (i);
+        i += 12;
+    }
+    return text;
+}
+/*************************/
+static QString generateSh (int lines)
+{
+    QString text = "#!/bin/bash\n\n";
+    int i = 2;
+    while (i < lines)
+    {
+        text += QString ("# function %1\n"
+                         "func%1() {\n"
+                         "    local var=\"$(echo \"nested $(date +%s) quotes\")\"\n"
+                         "    if [ -n \"$var\" ]; then\n"
+                         "        cat <<EOF%1\n"
+                         "Here-doc text with $var and 'quotes' (%1)\n"
+                         "\"unbalanced quote in a here-doc\n"
+                         "EOF%1\n"
+                         "    fi\n"
+                         "    echo 'single' \"double\" `backquoted`\n"
+                         "}\n\n").arg (i);
+        i += 12;
+    }
+    return text;
+}
+/*************************/
+static QString generateHtml (int lines)
+{
+    QString text = "<!DOCTYPE html>\n<html>\n<head>\n";
+    int i = 3;
+    while (i < lines)
+    {
+        text += QString ("<style type=\"text/css\">\n"
+                         "  .class%1 { color: #ff0000; margin: 0 auto; } /* comment */\n"
+                         "</style>\n"
+                         "<script type=\"text/javascript\">\n"
+                         "  var x%1 = /regex[0-9]+/g.test (\"string %1\"); // comment\n"
+                         "  function f%1 (a) { return a * %1; }\n"
+                         "</script>\n"
+                         "<div class=\"class%1\" id='id%1'><a href=\"https://example.com/%1\">link</a></div>\n"
+                         "<!-- a comment\n"
+                         "     on two lines -->\n").arg (i);
+        i += 10;
+    }
+    text += "</head>\n</html>\n";
+    return text;
+}
+/*************************/
+static QString generateMarkdown (int lines)
+{
+    QString text;
+    int i = 0;
+    while (i < lines)
+    {
+        text += QString ("# Heading %1\n"
+                         "\n"
+                         "Some *emphasized* and **bold** text with `code` and a [link](https://example.com/%1).\n"
+                         "\n"
+                         "> A block quote\n"
+                         "> on two lines\n"
+                         "\n"
+                         "```cpp\n"
+                         "int x = %1;\n"
+                         "```\n"
+                         "\n"
+                         "  * A list item\n").arg (i);
+        i += 12;
+    }
+    return text;
+}
+/*************************/
+static QString generateXml (int lines)
+{
+    QString text = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<root>\n";
+    int i = 2;
+    while (i < lines)
+    {
+        text += QString ("  <!-- item %1 -->\n"
+                         "  <item id=\"%1\" name='item%1'>\n"
+                         "    <value type=\"int\">%1</value>\n"
+                         "    <text>Some &amp; text</text>\n"
+                         "  </item>\n").arg (i);
+        i += 5;
+    }
+    text += "</root>\n";
+    return text;
+}
+/*************************/
+static QString generateLog (int lines)
+{
+    QString text;
+    for (int i = 0; i < lines; ++i)
+    {
+        text += QString ("Jan %1 12:%2:%3 host process[%4]: message number %4 with a path /usr/lib/file%4.so\n")
+                .arg (i % 28 + 1).arg (i % 60, 2, 10, QChar ('0')).arg (i % 59, 2, 10, QChar ('0')).arg (i);
+    }
+    return text;
+}
+/*************************/
+static QString languageOf (const QString &fileName)
+{
+    const QString suffix = QFileInfo (fileName).suffix().toLower();
+    if (suffix == "cpp" || suffix == "h" || suffix == "hpp" || suffix == "cc")
+        return "cpp";
+    if (suffix == "c") return "c";
+    if (suffix == "sh") return "sh";
+    if (suffix == "html" || suffix == "htm") return "html";
+    if (suffix == "md" || suffix == "markdown") return "markdown";
+    if (suffix == "xml" || suffix == "svg") return "xml";
+    if (suffix == "log") return "log";
+    if (suffix == "py") return "python";
+    if (suffix == "js") return "javascript";
+    if (suffix == "css") return "css";
+    if (suffix == "pl") return "perl";
+    return QString();
+}
+/*************************/
+static void addFile (const QString &path, QList<Sample> &samples)
+{
+    QFileInfo info (path);
+    if (info.isDir())
+    {
+        const QStringList files = QDir (path).entryList (QDir::Files, QDir::Name);
+        for (const QString &file : files)
+            addFile (QDir (path).filePath (file), samples);
+        return;
+    }
+    QString lang = languageOf (path);
+    if (lang.isEmpty()) return;
+    QFile file (path);
+    if (!file.open (QIODevice::ReadOnly)) return;
+    Sample sample;
+    sample.name = info.fileName();
+    sample.lang = lang;
+    sample.text = QString::fromUtf8 (file.readAll());
+    samples << sample;
+}
+/*************************/
+static QJsonObject measure (const Sample &sample)
+{
+    const bool peakReset = resetPeakMemory();
+    const qint64 baseMemory = statusValue ("VmRSS:");
+
+    QTextDocument doc;
+    doc.setPlainText (sample.text);
+
+    QTextCursor start (&doc);
+    QTextCursor end (doc.findBlockByNumber (qMin (VISIBLE_LINES, doc.blockCount()) - 1));
+    end.movePosition (QTextCursor::EndOfBlock);
+
+    /* highlighting of the whole document, as when a file is opened */
+    Highlighter *highlighter = new Highlighter (&doc, sample.lang, start, end, false, false, false);
+    QElapsedTimer timer;
+    timer.start();
+    highlighter->rehighlight();
+    double fullTime = msecs (timer);
+    const int compilations = pcreCompilations.load();
+
+    /* formatting of a visible window in the middle of the document, as when it's scrolled to */
+    QTextBlock block = doc.findBlockByNumber (doc.blockCount() / 2);
+    QTextBlock last = doc.findBlockByNumber (qMin (block.blockNumber() + VISIBLE_LINES, doc.blockCount() - 1));
+    highlighter->setLimit (QTextCursor (block), QTextCursor (last));
+    timer.restart();
+    while (block.isValid() && block.blockNumber() <= last.blockNumber())
+    {
+        if (TextBlockData *data = static_cast<TextBlockData *>(block.userData()))
+        {
+            if (!data->isHighlighted())
+                highlighter->rehighlightBlock (block);
+        }
+        block = block.next();
+    }
+    double visibleTime = msecs (timer);
+
+    /* a single-character edit at the top */
+    highlighter->setLimit (start, end);
+    QTextCursor cursor (&doc);
+    timer.restart();
+    cursor.insertText ("x");
+    double editTime = msecs (timer);
+    const int hotCompilations = pcreCompilations.load() - compilations;
+
+    delete highlighter;
+
+    QJsonObject result;
+    result["name"] = sample.name;
+    result["language"] = sample.lang;
+    result["lines"] = doc.blockCount();
+    result["characters"] = doc.characterCount();
+    result["fullHighlightMs"] = fullTime;
+    result["visibleHighlightMs"] = visibleTime;
+    result["editLatencyMs"] = editTime;
+    result["hotPathRegexCompilations"] = compilationsCounted() ? hotCompilations : -1;
+    const qint64 peakMemory = statusValue ("VmHWM:");
+    result["peakMemoryKiB"] = peakReset && baseMemory >= 0 && peakMemory >= 0
+                              ? peakMemory - baseMemory : -1;
+    return result;
+}
+/*************************/
+int main (int argc, char **argv)
+{
+    /* no window is shown */
+    if (qEnvironmentVariableIsEmpty ("QT_QPA_PLATFORM"))
+        qputenv ("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app (argc, argv);
+
+    int lines = 20000;
+    QString output;
+    QStringList paths;
+    const QStringList args = app.arguments().mid (1);
+    for (int i = 0; i < args.size(); ++i)
+    {
+        if (args.at (i) == "--lines" && i + 1 < args.size())
+            lines = qMax (args.at (++i).toInt(), VISIBLE_LINES);
+        else if (args.at (i) == "--output" && i + 1 < args.size())
+            output = args.at (++i);
+        else
+            paths << args.at (i);
+    }
+
+    QList<Sample> samples;
+    samples << Sample {"generated.cpp", "cpp", generateCpp (lines)}
+            << Sample {"generated.sh", "sh", generateSh (lines)}
+            << Sample {"generated.html", "html", generateHtml (lines)}
+            << Sample {"generated.md", "markdown", generateMarkdown (lines)}
+            << Sample {"generated.xml", "xml", generateXml (lines)}
+            << Sample {"generated.log", "log", generateLog (lines)};
+    for (const QString &path : static_cast<const QStringList&>(paths))
+        addFile (path, samples);
+
+    QJsonArray results;
+    for (const Sample &sample : static_cast<const QList<Sample>&>(samples))
+        results.append (measure (sample));
+
+    QJsonObject root;
+    root["qtVersion"] = QString (qVersion());
+    root["results"] = results;
+    const QByteArray json = QJsonDocument (root).toJson();
+
+    if (output.isEmpty())
+    {
+        fwrite (json.constData(), 1, json.size(), stdout);
+        return 0;
+    }
+    QFile file (output);
+    if (!file.open (QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        fprintf (stderr, "Cannot write to %s\n", qPrintable (output));
+        return 1;
+    }
+    file.write (json);
+    return 0;
+}
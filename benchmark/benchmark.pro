@@ -0,0 +1,31 @@
+# A standalone benchmark of syntax highlighting. It isn't built by default;
+# use "qmake CONFIG+=benchmark" in the top directory to build it with FeatherPad.
+
+QT += core gui
+
+TARGET = featherpad-benchmark
+TEMPLATE = app
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+# regex compilations are counted by interposing a function of PCRE2 (see "benchmark.cpp")
+unix {
+  QMAKE_LFLAGS += -rdynamic
+  LIBS += -ldl
+}
+
+INCLUDEPATH += ../featherpad
+
+SOURCES += benchmark.cpp \
+           ../featherpad/highlighter.cpp \
+           ../featherpad/highlighter-sh.cpp \
+           ../featherpad/highlighter-html.cpp \
+           ../featherpad/highlighter-patterns.cpp \
+           ../featherpad/highlighter-jsregex.cpp \
+           ../featherpad/highlighter-lexer.cpp \
+           ../featherpad/languages.cpp \
+           ../featherpad/regexps.cpp
+
+HEADERS += ../featherpad/highlighter.h \
+           ../featherpad/languages.h \
+           ../featherpad/regexps.h
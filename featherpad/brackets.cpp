@@ -42,6 +42,9 @@ void FPwin::matchBrackets()
     textEdit->setRedSel (QList<QTextEdit::ExtraSelection>());
     textEdit->setExtraSelections (es);
 
+    Highlighter *highlighter = qobject_cast< Highlighter *>(textEdit->getHighlighter());
+    if (highlighter == nullptr) return;
+
     QTextDocument *doc = textEdit->document();
     int curPos = cur.position();
     /* position of block's first character */
@@ -55,25 +58,29 @@ void FPwin::matchBrackets()
     bool findNextBrace (!isAtLeft || !isAtRight);
     if (isAtLeft || isAtRight)
     {
-        QVector<ParenthesisInfo *> infos = data->parentheses();
-        for (int i = 0; i < infos.size(); ++i)
+        int count = data->bracketCount (parenthesisKind);
+        for (int i = 0; i < count; ++i)
         {
-            ParenthesisInfo *info = infos.at (i);
+            const BracketInfo &info = data->bracketAt (parenthesisKind, i);
 
-            if (isAtLeft && info->position == curBlockPos && info->character == '(')
+            if (isAtLeft && info.position == curBlockPos && info.character == '(')
             {
-                if (matchLeftParenthesis (cur.block(), i + 1, 0))
+                int leftMatch = highlighter->matchingBracket (cur.block(), parenthesisKind, i, true);
+                if (leftMatch > -1)
                 {
-                    createSelection (blockPos + info->position);
+                    createSelection (leftMatch);
+                    createSelection (blockPos + info.position);
                     if (isAtRight) isAtLeft = false;
                     else break;
                 }
             }
-            if (isAtRight && info->position == curBlockPos - 1 && info->character == ')')
+            if (isAtRight && info.position == curBlockPos - 1 && info.character == ')')
             {
-                if (matchRightParenthesis (cur.block(), infos.size() - i, 0))
+                int rightMatch = highlighter->matchingBracket (cur.block(), parenthesisKind, i, false);
+                if (rightMatch > -1)
                 {
-                    createSelection (blockPos + info->position);
+                    createSelection (rightMatch);
+                    createSelection (blockPos + info.position);
                     if (isAtLeft) isAtRight = false;
                     else break;
                 }
@@ -88,25 +95,29 @@ void FPwin::matchBrackets()
     findNextBrace = !isAtLeft || !isAtRight;
     if (isAtLeft || isAtRight)
     {
-        QVector<BraceInfo *> braceInfos = data->braces();
-        for (int i = 0; i < braceInfos.size(); ++i)
+        int count = data->bracketCount (braceKind);
+        for (int i = 0; i < count; ++i)
         {
-            BraceInfo *info = braceInfos.at (i);
+            const BracketInfo &info = data->bracketAt (braceKind, i);
 
-            if (isAtLeft && info->position == curBlockPos && info->character == '{')
+            if (isAtLeft && info.position == curBlockPos && info.character == '{')
             {
-                if (matchLeftBrace (cur.block(), i + 1, 0))
+                int leftMatch = highlighter->matchingBracket (cur.block(), braceKind, i, true);
+                if (leftMatch > -1)
                 {
-                    createSelection (blockPos + info->position);
+                    createSelection (leftMatch);
+                    createSelection (blockPos + info.position);
                     if (isAtRight) isAtLeft = false;
                     else break;
                 }
             }
-            if (isAtRight && info->position == curBlockPos - 1 && info->character == '}')
+            if (isAtRight && info.position == curBlockPos - 1 && info.character == '}')
             {
-                if (matchRightBrace (cur.block(), braceInfos.size() - i, 0))
+                int rightMatch = highlighter->matchingBracket (cur.block(), braceKind, i, false);
+                if (rightMatch > -1)
                 {
-                    createSelection (blockPos + info->position);
+                    createSelection (rightMatch);
+                    createSelection (blockPos + info.position);
                     if (isAtLeft) isAtRight = false;
                     else break;
                 }
@@ -120,25 +131,29 @@ void FPwin::matchBrackets()
     isAtRight = (doc->characterAt (curPos - 1) == ']');
     if (isAtLeft || isAtRight)
     {
-        QVector<BracketInfo *> bracketInfos = data->brackets();
-        for (int i = 0; i < bracketInfos.size(); ++i)
+        int count = data->bracketCount (squareBracketKind);
+        for (int i = 0; i < count; ++i)
         {
-            BracketInfo *info = bracketInfos.at (i);
+            const BracketInfo &info = data->bracketAt (squareBracketKind, i);
 
-            if (isAtLeft && info->position == curBlockPos && info->character == '[')
+            if (isAtLeft && info.position == curBlockPos && info.character == '[')
             {
-                if (matchLeftBracket (cur.block(), i + 1, 0))
+                int leftMatch = highlighter->matchingBracket (cur.block(), squareBracketKind, i, true);
+                if (leftMatch > -1)
                 {
-                    createSelection (blockPos + info->position);
+                    createSelection (leftMatch);
+                    createSelection (blockPos + info.position);
                     if (isAtRight) isAtLeft = false;
                     else break;
                 }
             }
-            if (isAtRight && info->position == curBlockPos - 1 && info->character == ']')
+            if (isAtRight && info.position == curBlockPos - 1 && info.character == ']')
             {
-                if (matchRightBracket (cur.block(), bracketInfos.size() - i, 0))
+                int rightMatch = highlighter->matchingBracket (cur.block(), squareBracketKind, i, false);
+                if (rightMatch > -1)
                 {
-                    createSelection (blockPos + info->position);
+                    createSelection (rightMatch);
+                    createSelection (blockPos + info.position);
                     if (isAtLeft) isAtRight = false;
                     else break;
                 }
@@ -147,195 +162,6 @@ void FPwin::matchBrackets()
     }
 }
 /*************************/
-bool FPwin::matchLeftParenthesis (QTextBlock currentBlock, int i, int numLeftParentheses)
-{
-    TextBlockData *data = static_cast<TextBlockData *>(currentBlock.userData());
-    if (!data) return false;
-    QVector<ParenthesisInfo *> infos = data->parentheses();
-
-    int docPos = currentBlock.position();
-    for (; i < infos.size(); ++i)
-    {
-        ParenthesisInfo *info = infos.at (i);
-        if (info->character == '(')
-        {
-            ++numLeftParentheses;
-            continue;
-        }
-
-        if (info->character == ')' && numLeftParentheses == 0)
-        {
-            createSelection (docPos + info->position);
-            return true;
-        }
-        else
-            --numLeftParentheses;
-    }
-
-    currentBlock = currentBlock.next();
-    if (currentBlock.isValid())
-        return matchLeftParenthesis (currentBlock, 0, numLeftParentheses);
-
-    return false;
-}
-/*************************/
-bool FPwin::matchRightParenthesis (QTextBlock currentBlock, int i, int numRightParentheses)
-{
-    TextBlockData *data = static_cast<TextBlockData *>(currentBlock.userData());
-    if (!data) return false;
-    QVector<ParenthesisInfo *> infos = data->parentheses();
-
-    int docPos = currentBlock.position();
-    for (; i < infos.size(); ++i)
-    {
-        ParenthesisInfo *info = infos.at (infos.size() - 1 - i);
-        if (info->character == ')')
-        {
-            ++numRightParentheses;
-            continue;
-        }
-        if (info->character == '(' && numRightParentheses == 0)
-        {
-            createSelection (docPos + info->position);
-            return true;
-        }
-        else
-            --numRightParentheses;
-    }
-
-    currentBlock = currentBlock.previous();
-    if (currentBlock.isValid())
-        return matchRightParenthesis (currentBlock, 0, numRightParentheses);
-
-    return false;
-}
-/*************************/
-bool FPwin::matchLeftBrace (QTextBlock currentBlock, int i, int numRightBraces)
-{
-    TextBlockData *data = static_cast<TextBlockData *>(currentBlock.userData());
-    if (!data) return false;
-    QVector<BraceInfo *> infos = data->braces();
-
-    int docPos = currentBlock.position();
-    for (; i < infos.size(); ++i)
-    {
-        BraceInfo *info = infos.at (i);
-        if (info->character == '{')
-        {
-            ++numRightBraces;
-            continue;
-        }
-
-        if (info->character == '}' && numRightBraces == 0)
-        {
-            createSelection (docPos + info->position);
-            return true;
-        }
-        else
-            --numRightBraces;
-    }
-
-    currentBlock = currentBlock.next();
-    if (currentBlock.isValid())
-        return matchLeftBrace (currentBlock, 0, numRightBraces);
-
-    return false;
-}
-/*************************/
-bool FPwin::matchRightBrace (QTextBlock currentBlock, int i, int numLeftBraces)
-{
-    TextBlockData *data = static_cast<TextBlockData *>(currentBlock.userData());
-    if (!data) return false;
-    QVector<BraceInfo *> infos = data->braces();
-
-    int docPos = currentBlock.position();
-    for (; i < infos.size(); ++i)
-    {
-        BraceInfo *info = infos.at (infos.size() - 1 - i);
-        if (info->character == '}')
-        {
-            ++numLeftBraces;
-            continue;
-        }
-        if (info->character == '{' && numLeftBraces == 0)
-        {
-            createSelection (docPos + info->position);
-            return true;
-        }
-        else
-            --numLeftBraces;
-    }
-
-    currentBlock = currentBlock.previous();
-    if (currentBlock.isValid())
-        return matchRightBrace (currentBlock, 0, numLeftBraces);
-
-    return false;
-}
-/*************************/
-bool FPwin::matchLeftBracket (QTextBlock currentBlock, int i, int numRightBrackets)
-{
-    TextBlockData *data = static_cast<TextBlockData *>(currentBlock.userData());
-    if (!data) return false;
-    QVector<BracketInfo *> infos = data->brackets();
-
-    int docPos = currentBlock.position();
-    for (; i < infos.size(); ++i)
-    {
-        BracketInfo *info = infos.at (i);
-        if (info->character == '[')
-        {
-            ++numRightBrackets;
-            continue;
-        }
-
-        if (info->character == ']' && numRightBrackets == 0)
-        {
-            createSelection (docPos + info->position);
-            return true;
-        }
-        else
-            --numRightBrackets;
-    }
-
-    currentBlock = currentBlock.next();
-    if (currentBlock.isValid())
-        return matchLeftBracket (currentBlock, 0, numRightBrackets);
-
-    return false;
-}
-/*************************/
-bool FPwin::matchRightBracket (QTextBlock currentBlock, int i, int numLeftBrackets)
-{
-    TextBlockData *data = static_cast<TextBlockData *>(currentBlock.userData());
-    if (!data) return false;
-    QVector<BracketInfo *> infos = data->brackets();
-
-    int docPos = currentBlock.position();
-    for (; i < infos.size(); ++i)
-    {
-        BracketInfo *info = infos.at (infos.size() - 1 - i);
-        if (info->character == ']')
-        {
-            ++numLeftBrackets;
-            continue;
-        }
-        if (info->character == '[' && numLeftBrackets == 0)
-        {
-            createSelection (docPos + info->position);
-            return true;
-        }
-        else
-            --numLeftBrackets;
-    }
-
-    currentBlock = currentBlock.previous();
-    if (currentBlock.isValid())
-        return matchRightBracket (currentBlock, 0, numLeftBrackets);
-
-    return false;
-}
-/*************************/
 void FPwin::createSelection (int pos)
 {
     int index = ui->tabWidget->currentIndex();
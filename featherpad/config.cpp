@@ -70,6 +70,9 @@ Config::Config():
     font_ (QFont ("Monospace", 9)),
     openRecentFiles_ (0),
     recentOpened_ (false),
+    lazyTabs_ (true),
+    memoryBudget_ (512),
+    evictionIdle_ (10),
     cursorPosRetrieved_ (false) {}
 /*************************/
 Config::~Config() {}
@@ -233,6 +236,11 @@ void Config::readConfig()
     openRecentFiles_ = qBound (0, settings.value ("openRecentFiles", 0).toInt(), recentFilesNumber_);
     if (settings.value ("recentOpened").toBool())
         recentOpened_ = true; // false by default
+    v = settings.value ("lazyTabs");
+    if (v.isValid()) // true by default
+        lazyTabs_ = v.toBool();
+    memoryBudget_ = qBound (0, settings.value ("memoryBudget", 512).toInt(), 65536);
+    evictionIdle_ = qBound (1, settings.value ("evictionIdle", 10).toInt(), 1440);
 
     autoSaveInterval_ = qBound (1, settings.value ("autoSaveInterval", 1).toInt(), 60);
 
@@ -346,6 +354,9 @@ void Config::writeConfig()
         settings.setValue ("recentFiles", recentFiles_);
     settings.setValue ("openRecentFiles", openRecentFiles_);
     settings.setValue ("recentOpened", recentOpened_);
+    settings.setValue ("lazyTabs", lazyTabs_);
+    settings.setValue ("memoryBudget", memoryBudget_);
+    settings.setValue ("evictionIdle", evictionIdle_);
 
     settings.setValue ("autoSaveInterval", autoSaveInterval_);
 
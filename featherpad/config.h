@@ -361,6 +361,27 @@ public:
         recentOpened_ = opened;
     }
 
+    bool getLazyTabs() const {
+        return lazyTabs_;
+    }
+    void setLazyTabs (bool lazy) {
+        lazyTabs_ = lazy;
+    }
+
+    int getMemoryBudget() const {
+        return memoryBudget_;
+    }
+    void setMemoryBudget (int budget) {
+        memoryBudget_ = qBound (0, budget, 65536);
+    }
+
+    int getEvictionIdle() const {
+        return evictionIdle_;
+    }
+    void setEvictionIdle (int minutes) {
+        evictionIdle_ = qBound (1, minutes, 1440);
+    }
+
     QStringList getLastFiles() const;
 
     QStringList getRecentFiles() const {
@@ -471,6 +492,9 @@ private:
     QString executeCommand_;
     int openRecentFiles_;
     bool recentOpened_;
+    bool lazyTabs_; // Should restored files be loaded only when their tabs are activated?
+    int memoryBudget_; // The memory (in MiB) that documents may use before inactive ones are released (0 for no limit).
+    int evictionIdle_; // The minutes after which an unvisited tab may be released.
     QStringList recentFiles_;
     QHash<QString, QString> actions_;
     QStringList removedActions_, reservedShortcuts_;
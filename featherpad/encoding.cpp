@@ -30,8 +30,17 @@
 #include <langinfo.h> // CODESET, nl_langinfo
 #include <stdint.h> // uint8_t, uint32_t
 #include <locale.h> // needed by FreeBSD for setlocale
+#include <string.h> // memchr
 #include "encoding.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define FP_AVX2_DISPATCH
+#endif
+
 namespace FeatherPad {
 
 #define MAX_COUNTRY_NUM 10
@@ -497,29 +506,123 @@ static bool detect_noniso (const char *text)
     return false;
 }
 /*************************/
+/* The ASCII bytes at the start of [bytes, end) are skipped with
+   the widest vector instructions that the CPU supports. Each
+   function returns the position of the first non-ASCII byte
+   (or end) and sets "esc" if an ESC character is skipped. */
+typedef const unsigned char* (*AsciiSpanFunc) (const unsigned char *bytes, const unsigned char *end, bool &esc);
+
+static const unsigned char* asciiSpanScalar (const unsigned char *bytes, const unsigned char *end, bool &esc)
+{
+    while (bytes < end && *bytes < 0x80)
+    {
+        if (*bytes == 0x1B)
+            esc = true;
+        ++bytes;
+    }
+    return bytes;
+}
+
+#if defined(__SSE2__)
+static const unsigned char* asciiSpanSSE2 (const unsigned char *bytes, const unsigned char *end, bool &esc)
+{
+    const __m128i escs = _mm_set1_epi8 (0x1B);
+    while (end - bytes >= 16)
+    {
+        const __m128i v = _mm_loadu_si128 (reinterpret_cast<const __m128i*>(bytes));
+        if (_mm_movemask_epi8 (v) != 0) // a byte has its high bit set
+            break;
+        if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (v, escs)) != 0)
+            esc = true;
+        bytes += 16;
+    }
+    return asciiSpanScalar (bytes, end, esc);
+}
+#endif
+
+#if defined(FP_AVX2_DISPATCH)
+__attribute__((target("avx2")))
+static const unsigned char* asciiSpanAVX2 (const unsigned char *bytes, const unsigned char *end, bool &esc)
+{
+    const __m256i escs = _mm256_set1_epi8 (0x1B);
+    while (end - bytes >= 32)
+    {
+        const __m256i v = _mm256_loadu_si256 (reinterpret_cast<const __m256i*>(bytes));
+        if (_mm256_movemask_epi8 (v) != 0)
+            break;
+        if (_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (v, escs)) != 0)
+            esc = true;
+        bytes += 32;
+    }
+    return asciiSpanScalar (bytes, end, esc);
+}
+#endif
+
+static AsciiSpanFunc chooseAsciiSpan()
+{
+#if defined(FP_AVX2_DISPATCH)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports ("avx2"))
+        return asciiSpanAVX2;
+#endif
+#if defined(__SSE2__)
+    return asciiSpanSSE2;
+#else
+    return asciiSpanScalar;
+#endif
+}
+
+static const AsciiSpanFunc asciiSpan = chooseAsciiSpan();
+/*************************/
+/* Legacy encodings of texts larger than this are first detected in samples. */
+static const int SAMPLING_SIZE = 4*1024*1024;
+static const int WINDOW_SIZE = 64*1024;
+static const int MIDDLE_WINDOWS = 8;
+/* A sample is enough for detecting a legacy encoding if it has this number of non-ASCII bytes. */
+static const int MIN_SAMPLE_NON_ASCII = 256;
+/* A legacy encoding found with fewer non-ASCII bytes is just a guess. */
+static const int MIN_NON_ASCII = 16;
+/*************************/
+struct UTF8Info
+{
+    bool valid; // is it valid UTF-8?
+    bool ascii; // is it pure ASCII?
+    bool esc; // does it contain ESC?
+};
+
 /* In the GTK+ version, I used g_utf8_validate()
    but this function validates UTF-8 directly
    and seems faster than using QTextCodec::ConverterState
-   with QTextCodec::toUnicode(), which may give incorrect results. */
-bool validateUTF8 (const QByteArray byteArray)
-{
-    const char *string = byteArray.constData();
-    if (!string) return true;
+   with QTextCodec::toUnicode(), which may give incorrect results.
 
-    const unsigned char *bytes = (const unsigned char*)string;
+   ASCII bytes are skipped in vectorized spans and only multibyte
+   sequences are decoded one by one. The whole text is checked (even
+   if it has null characters) and everything is found in one pass. */
+static UTF8Info scanUTF8 (const char *string, int size)
+{
+    UTF8Info info;
+    info.valid = true;
+    info.ascii = true;
+    info.esc = false;
+    if (!string || size <= 0) return info;
+
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(string);
+    const unsigned char *end = bytes + size;
     unsigned int cp; // code point
     int bn; // bytes number
 
-    while (*bytes != 0x00)
+    while (bytes < end)
     {
+        if (*bytes < 0x80)
+        {
+            bytes = asciiSpan (bytes, end, info.esc);
+            if (bytes == end) break;
+        }
+        info.ascii = false;
+
         /* assuming that UTF-8 maps a sequence of 1-4 bytes,
            we find the code point and the number of bytes */
-        if ((*bytes & 0x80) == 0x00)
-        { // 0xxxxxxx, all ASCII characters (0-127)
-            cp = (*bytes & 0x7F);
-            bn = 1;
-        }
-        else if ((*bytes & 0xE0) == 0xC0)
+        if ((*bytes & 0xE0) == 0xC0)
         { // 110xxxxx 10xxxxxx
             cp = (*bytes & 0x1F);
             bn = 2;
@@ -535,14 +638,25 @@ bool validateUTF8 (const QByteArray byteArray)
             bn = 4;
         }
         else
-            return false;
+        {
+            info.valid = false;
+            return info;
+        }
 
+        if (end - bytes < bn) // a truncated sequence
+        {
+            info.valid = false;
+            return info;
+        }
         bytes += 1;
         for (int i = 1; i < bn; ++i)
         {
             /* all the other bytes should be of the form 10xxxxxx */
             if ((*bytes & 0xC0) != 0x80)
-                return false;
+            {
+                info.valid = false;
+                return info;
+            }
             cp = (cp << 6) | (*bytes & 0x3F);
             bytes += 1;
         }
@@ -557,58 +671,230 @@ bool validateUTF8 (const QByteArray byteArray)
             || (cp >= 0x0800 && cp <= 0xFFFF && bn != 3)
             || (cp >= 0x10000 && cp <= 0x1FFFFF && bn != 4))
         {
-            return false;
+            info.valid = false;
+            return info;
         }
     }
 
-    return true;
+    return info;
+}
+/*************************/
+bool validateUTF8 (const QByteArray byteArray)
+{
+    return scanUTF8 (byteArray.constData(), byteArray.size()).valid;
+}
+/*************************/
+/* Guesses the encoding of a NUL-terminated text that isn't UTF-8
+   by using the method that suits the locale. */
+static const std::string detectLegacyCharset (const char *text)
+{
+    std::string charset;
+    switch (localeNum)
+    {
+        case LATIN1:
+            /* Windows-1252 */
+            charset = detectCharsetLatin (text);
+            break;
+        case LATINC:
+        case LATINC_UA:
+        case LATINC_TJ:
+            /* Cyrillic */
+            charset = detectCharsetCyrillic (text);
+            break;
+        case LATINA:
+            /* MS Windows Arabic */
+            charset = detectCharsetWinArabic (text);
+            break;
+        case CHINESE_CN:
+        case CHINESE_TW:
+        case CHINESE_HK:
+            charset = detectCharsetChinese (text);
+            break;
+        case JAPANESE:
+            charset = detectCharsetJapanese (text);
+            break;
+        case KOREAN:
+            charset = detectCharsetKorean (text);
+            break;
+        case VIETNAMESE:
+        case THAI:
+        case GEORGIAN:
+            charset = encodingItem[OPENI18N];
+            break;
+        default:
+            if (getDefaultCharset() != "UTF-8")
+                charset = getDefaultCharset();
+            else if (detect_noniso (text))
+                charset = encodingItem[CODEPAGE];
+            else
+                charset = encodingItem[OPENI18N];
+            if (charset.empty())
+                charset = encodingItem[IANA];
+    }
+
+    return charset;
+}
+/*************************/
+/* The number of non-ASCII bytes shows how much a legacy encoding can be trusted. */
+static int countNonASCII (const char *text, int size)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(text);
+    const unsigned char *end = bytes + size;
+    bool esc = false;
+    int n = 0;
+    while ((bytes = asciiSpan (bytes, end, esc)) < end)
+    {
+        ++n;
+        ++bytes;
+    }
+    return n;
+}
+/*************************/
+/* Skips the continuation bytes at the start of [start, end), so that
+   a window doesn't begin in the middle of a UTF-8 character. */
+static const char* charStart (const char *start, const char *end)
+{
+    for (int i = 0; i < 3 && start < end
+                    && (static_cast<unsigned char>(*start) & 0xC0) == 0x80; ++i)
+        ++start;
+    return start;
+}
+/* Drops an incomplete multibyte sequence at the end of [start, end). */
+static const char* charEnd (const char *start, const char *end)
+{
+    const char *p = end;
+    for (int i = 0; i < 4 && p > start; ++i)
+    {
+        const unsigned char c = static_cast<unsigned char>(*(p - 1));
+        if (c < 0x80) return end;
+        --p;
+        if ((c & 0xC0) == 0xC0)
+        { // a lead byte; see if its sequence is complete
+            const int bn = (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : 4;
+            return end - p >= bn ? end : p;
+        }
+    }
+    return end;
+}
+/*************************/
+/* Finds the start of the first line in [start, end)
+   (or the first character boundary, if there's no line break in the range). */
+static const char* firstLineStart (const char *start, const char *end)
+{
+    const char *p = static_cast<const char*>(memchr (start, '\n', end - start));
+    return p ? p + 1 : charStart (start, end);
+}
+/* Finds the end of the last complete line in [start, end)
+   (or the last character boundary). */
+static const char* lastLineEnd (const char *start, const char *end)
+{
+    const char *p = end;
+    while (p > start && *(p - 1) != '\n') --p;
+    return p > start ? p : charEnd (start, end);
 }
 /*************************/
-const QString detectCharset (const QByteArray& byteArray)
+/* Makes a sample of a large text out of its head, its tail and a few windows
+   in its middle. Each middle window is at a pseudo-random but reproducible
+   position inside its own part of the text, so that the whole text is covered
+   evenly. Windows are trimmed to whole lines (or at least, to whole characters)
+   to keep multibyte characters. */
+static QByteArray sampleText (const QByteArray& byteArray)
 {
+    const char *data = byteArray.constData();
+    const int size = byteArray.size();
+    QByteArray sample;
+    sample.reserve ((MIDDLE_WINDOWS + 2) * (WINDOW_SIZE + 1));
+
+    sample.append (data, static_cast<int>(lastLineEnd (data, data + WINDOW_SIZE) - data));
+    const int part = (size - 2 * WINDOW_SIZE) / MIDDLE_WINDOWS;
+    uint32_t seed = static_cast<uint32_t>(size);
+    for (int i = 0; i < MIDDLE_WINDOWS; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        const int offset = part > WINDOW_SIZE ? static_cast<int>((seed >> 8) % (part - WINDOW_SIZE)) : 0;
+        const char *start = data + WINDOW_SIZE + i * part + offset;
+        const char *end = qMin (start + WINDOW_SIZE, data + size - WINDOW_SIZE);
+        start = firstLineStart (start, end);
+        sample += '\n';
+        sample.append (start, static_cast<int>(lastLineEnd (start, end) - start));
+    }
+    const char *start = firstLineStart (data + size - WINDOW_SIZE, data + size);
+    sample += '\n';
+    sample.append (start, static_cast<int>(data + size - start));
+    return sample;
+}
+/*************************/
+// The whole text is always checked for UTF-8. If it isn't UTF-8, the legacy
+// detectors examine samples of a large text first and look into the whole
+// text only when the samples aren't enough for a confident detection. "sure"
+// is set to false if the encoding is a guess based on too few non-ASCII characters.
+const QString detectCharset (const QByteArray& byteArray, bool *sure)
+{
+    const UTF8Info info = scanUTF8 (byteArray.constData(), byteArray.size());
+    if (!info.valid && byteArray.size() > SAMPLING_SIZE)
+    {
+        const QByteArray sample = sampleText (byteArray);
+        if (countNonASCII (sample.constData(), sample.size()) >= MIN_SAMPLE_NON_ASCII)
+        { // there are enough non-ASCII characters for statistics
+            if (sure)
+                *sure = true;
+            return QString::fromStdString (detectLegacyCharset (sample.constData()));
+        }
+    }
+
+    /* the text may not be NUL-terminated (as with QByteArray::fromRawData()) */
     const char* text = byteArray.constData();
-    uint8_t c = *text;
+    const char* end = text + byteArray.size();
+    uint8_t c;
     std::string charset;
 
-    if (validateUTF8 (byteArray))
+    if (info.valid)
     {
-        while ((c = *text++) != '\0')
+        if (!info.esc) // no escape sequence to look into
         {
-            if (c > 0x7F)
-            {
+            if (!info.ascii)
                 charset = "UTF-8";
-                break;
-            }
-            if (c == 0x1B) /* ESC */
+        }
+        else
+        { // check the escape sequences before the first non-ASCII character
+            while (text < end && (c = *text++) != '\0')
             {
-                c = *text++;
-                if (c == '$')
+                if (c > 0x7F)
                 {
-                    c = *text++;
-                    switch (c)
+                    charset = "UTF-8";
+                    break;
+                }
+                if (c == 0x1B) /* ESC */
+                {
+                    c = text < end ? *text++ : '\0';
+                    if (c == '$')
                     {
-                    case 'B': // JIS X 0208-1983
-                    case '@': // JIS X 0208-1978
-                        charset = "ISO-2022-JP";
-                        continue;
-                    case 'A': // GB2312-1980
-                        charset = "ISO-2022-JP-2";
-                        break;
-                    case '(':
-                        c = *text++;
+                        c = text < end ? *text++ : '\0';
                         switch (c)
                         {
-                        case 'C': // KSC5601-1987
-                        case 'D': // JIS X 0212-1990
+                        case 'B': // JIS X 0208-1983
+                        case '@': // JIS X 0208-1978
+                            charset = "ISO-2022-JP";
+                            continue;
+                        case 'A': // GB2312-1980
                             charset = "ISO-2022-JP-2";
+                            break;
+                        case '(':
+                            c = text < end ? *text++ : '\0';
+                            switch (c)
+                            {
+                            case 'C': // KSC5601-1987
+                            case 'D': // JIS X 0212-1990
+                                charset = "ISO-2022-JP-2";
+                            }
+                            break;
+                        case ')':
+                            c = text < end ? *text++ : '\0';
+                            if (c == 'C')
+                                charset = "ISO-2022-KR"; // KSC5601-1987
                         }
                         break;
-                    case ')':
-                        c = *text++;
-                        if (c == 'C')
-                            charset = "ISO-2022-KR"; // KSC5601-1987
                     }
-                    break;
                 }
             }
         }
@@ -618,49 +904,14 @@ const QString detectCharset (const QByteArray& byteArray)
 
     if (charset.empty())
     {
-        switch (localeNum)
-        {
-            case LATIN1:
-                /* Windows-1252 */
-                charset = detectCharsetLatin (text);
-                break;
-            case LATINC:
-            case LATINC_UA:
-            case LATINC_TJ:
-                /* Cyrillic */
-                charset = detectCharsetCyrillic (text);
-                break;
-            case LATINA:
-                /* MS Windows Arabic */
-                charset = detectCharsetWinArabic (text);
-                break;
-            case CHINESE_CN:
-            case CHINESE_TW:
-            case CHINESE_HK:
-                charset = detectCharsetChinese (text);
-                break;
-            case JAPANESE:
-                charset = detectCharsetJapanese (text);
-                break;
-            case KOREAN:
-                charset = detectCharsetKorean (text);
-                break;
-            case VIETNAMESE:
-            case THAI:
-            case GEORGIAN:
-                charset = encodingItem[OPENI18N];
-                break;
-            default:
-                if (getDefaultCharset() != "UTF-8")
-                    charset = getDefaultCharset();
-                else if (detect_noniso (text))
-                    charset = encodingItem[CODEPAGE];
-                else
-                    charset = encodingItem[OPENI18N];
-                if (charset.empty())
-                    charset = encodingItem[IANA];
-        }
+        /* the legacy detectors need a NUL-terminated text */
+        const QByteArray copy (byteArray.constData(), byteArray.size());
+        charset = detectLegacyCharset (copy.constData());
+        if (sure)
+            *sure = countNonASCII (copy.constData(), copy.size()) >= MIN_NON_ASCII;
     }
+    else if (sure)
+        *sure = true;
 
     return QString::fromStdString (charset);
 }
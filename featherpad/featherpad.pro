@@ -29,8 +29,16 @@ SOURCES += main.cpp \
            highlighter-html.cpp \
            highlighter-patterns.cpp \
            highlighter-jsregex.cpp \
+           highlighter-lexer.cpp \
+           languages.cpp \
+           regexps.cpp \
            vscrollbar.cpp \
            loading.cpp \
+           pagedfile.cpp \
+           textsearch.cpp \
+           regexsearch.cpp \
+           searchindex.cpp \
+           lineindex.cpp \
            tabpage.cpp \
            searchbar.cpp \
            session.cpp \
@@ -46,11 +54,19 @@ HEADERS += singleton.h \
            tabbar.h \
            x11.h \
            highlighter.h \
+           languages.h \
+           regexps.h \
            vscrollbar.h \
            filedialog.h \
            config.h \
            pref.h \
            loading.h \
+           pagedfile.h \
+           textsearch.h \
+           regexsearch.h \
+           searchindex.h \
+           streaming.h \
+           lineindex.h \
            messagebox.h \
            tabpage.h \
            searchbar.h \
@@ -20,77 +20,21 @@
 #include "fpwin.h"
 #include "ui_fp.h"
 #include <QTextDocumentFragment>
+#include "textsearch.h"
+#include "regexsearch.h"
+#include "searchindex.h"
+#include <algorithm>
 
 namespace FeatherPad {
 
 /* This order is preserved everywhere for selections:
    current line -> replacement -> found matches -> bracket matches */
 
-/************************************************************************
- ***** Qt's backward search has some bugs. Therefore, we do our own *****
- ***** backward search by using the following two static functions. *****
- ************************************************************************/
-static bool findBackwardInBlock (const QTextBlock &block, const QString &str, int offset,
-                                 QTextCursor &cursor, QTextDocument::FindFlags flags)
-{
-    Qt::CaseSensitivity cs = !(flags & QTextDocument::FindCaseSensitively)
-                             ? Qt::CaseInsensitive : Qt::CaseSensitive;
-
-    QString text = block.text();
-    text.replace (QChar::Nbsp, QLatin1Char (' '));
-
-    int idx = -1;
-    while (offset >= 0 && offset <= text.length())
-    {
-        idx = text.lastIndexOf (str, offset, cs);
-        if (idx == -1)
-            return false;
-        if (flags & QTextDocument::FindWholeWords)
-        {
-            const int start = idx;
-            const int end = start + str.length();
-            if ((start != 0 && text.at (start - 1).isLetterOrNumber())
-                || (end != text.length() && text.at (end).isLetterOrNumber()))
-            { // if this is not a whole word, continue the backward search
-                offset = idx - 1;
-                idx = -1;
-                continue;
-            }
-        }
-        cursor.setPosition (block.position() + idx);
-        cursor.setPosition (cursor.position() + str.length(), QTextCursor::KeepAnchor);
-        return true;
-    }
-    return false;
-}
-
-static bool findBackward (const QTextDocument *txtdoc, const QString str,
-                          QTextCursor &cursor, QTextDocument::FindFlags flags)
-{
-    if (!str.isEmpty() && !cursor.isNull())
-    {
-        int pos = cursor.anchor()
-                  - str.size(); // we don't want a match with the cursor inside it
-        if (pos >= 0)
-        {
-            QTextBlock block = txtdoc->findBlock (pos);
-            int blockOffset = pos - block.position();
-            while (block.isValid())
-            {
-                if (findBackwardInBlock (block, str, blockOffset, cursor, flags))
-                    return true;
-                block = block.previous();
-                blockOffset = block.length() - 2; // newline is included in length()
-            }
-        }
-    }
-    cursor = QTextCursor();
-    return false;
-}
-/*************************/
-// This method extends the searchable strings to those with line breaks.
-// It also corrects the behavior of Qt's backward search and can set an
-// end limit to the forward search.
+// Finds the string in a snapshot of the text, forward or backward. The search
+// is the same for strings with line breaks and a forward search can have an end
+// limit. As with QTextDocument::find(), a forward search starts after the selection
+// but a backward search doesn't find a match with the cursor inside it.
+// Regexes aren't searched here (-> startRegexSearch()).
 QTextCursor FPwin::finding (const QString& str, const QTextCursor& start, QTextDocument::FindFlags flags,
                             const int end) const
 {
@@ -98,231 +42,78 @@ QTextCursor FPwin::finding (const QString& str, const QTextCursor& start, QTextD
     if (ui->tabWidget->currentIndex() == -1 || str.isEmpty())
         return QTextCursor(); // null cursor
 
-    QTextDocument *txtdoc = qobject_cast< TabPage *>(ui->tabWidget->currentWidget())
-                            ->textEdit()->document();
-    QTextCursor res = start;
-    if (str.contains ('\n'))
+    TextEdit *textEdit = qobject_cast< TabPage *>(ui->tabWidget->currentWidget())->textEdit();
+    const QString &text = textEdit->textSnapshot();
+    TextSearch search (str, flags);
+    int index;
+    if (!(flags & QTextDocument::FindBackward))
     {
-        QTextCursor cursor = start;
-        QTextCursor found;
-        QStringList sl = str.split ("\n");
-        int i = 0;
-        Qt::CaseSensitivity cs = !(flags & QTextDocument::FindCaseSensitively)
-                                 ? Qt::CaseInsensitive : Qt::CaseSensitive;
-        QString subStr;
-        if (!(flags & QTextDocument::FindBackward))
-        {
-            /* this loop searches for the consecutive
-               occurrences of newline separated strings */
-            while (i < sl.count())
-            {
-                if (i == 0) // the first string
-                {
-                    subStr = sl.at (0);
-                    /* when the first string is empty... */
-                    if (subStr.isEmpty())
-                    {
-                        /* ... search anew from the next block */
-                        cursor.movePosition (QTextCursor::EndOfBlock);
-                        if (end > 0 && cursor.anchor() > end)
-                            return QTextCursor();
-                        res.setPosition (cursor.position());
-                        if (!cursor.movePosition (QTextCursor::NextBlock))
-                            return QTextCursor();
-                        ++i;
-                    }
-                    else
-                    {
-                        if ((found = txtdoc->find (subStr, cursor, flags)).isNull())
-                            return QTextCursor();
-                        if (end > 0 && found.anchor() > end)
-                            return QTextCursor();
-                        cursor.setPosition (found.position());
-                        /* if the match doesn't end the block... */
-                        while (!cursor.atBlockEnd())
-                        {
-                            /* ... move the cursor to right and search until a match is found */
-                            cursor.movePosition (QTextCursor::EndOfBlock);
-                            cursor.setPosition (cursor.position() - subStr.length());
-                            if ((found = txtdoc->find (subStr, cursor, flags)).isNull())
-                                return QTextCursor();
-                            if (end > 0 && found.anchor() > end)
-                                return QTextCursor();
-                            cursor.setPosition (found.position());
-                        }
-
-                        res.setPosition (found.anchor());
-                        if (!cursor.movePosition (QTextCursor::NextBlock))
-                            return QTextCursor();
-                        ++i;
-                    }
-                }
-                else if (i != sl.count() - 1) // middle strings
-                {
-                    /* when the next block's test isn't the next string... */
-                    if (QString::compare (cursor.block().text(), sl.at (i), cs) != 0)
-                    {
-                        /* ... reset the loop cautiously */
-                        cursor.setPosition (res.position());
-                        if (!cursor.movePosition (QTextCursor::NextBlock))
-                            return QTextCursor();
-                        i = 0;
-                        continue;
-                    }
-
-                    if (!cursor.movePosition (QTextCursor::NextBlock))
-                        return QTextCursor();
-                    ++i;
-                }
-                else // the last string (i == sl.count() - 1)
-                {
-                    subStr = sl.at (i);
-                    if (subStr.isEmpty()) break;
-                    if (!(flags & QTextDocument::FindWholeWords))
-                    {
-                        /* when the last string doesn't start the next block... */
-                        if (!cursor.block().text().startsWith (subStr, cs))
-                        {
-                            /* ... reset the loop cautiously */
-                            cursor.setPosition (res.position());
-                            if (!cursor.movePosition (QTextCursor::NextBlock))
-                                return QTextCursor();
-                            i = 0;
-                            continue;
-                        }
-                        cursor.setPosition (cursor.anchor() + subStr.count());
-                        break;
-                    }
-                    else
-                    {
-                        if ((found = txtdoc->find (subStr, cursor, flags)).isNull()
-                            || found.anchor() != cursor.position())
-                        {
-                            cursor.setPosition (res.position());
-                            if (!cursor.movePosition (QTextCursor::NextBlock))
-                                return QTextCursor();
-                            i = 0;
-                            continue;
-                        }
-                        cursor.setPosition (found.position());
-                        break;
-                    }
-                }
-            }
-            res.setPosition (cursor.position(), QTextCursor::KeepAnchor);
-        }
-        else // backward search
-        {
-            cursor.setPosition (cursor.anchor());
-            int endPos = cursor.position();
-            while (i < sl.count())
-            {
-                if (i == 0) // the last string
-                {
-                    subStr = sl.at (sl.count() - 1);
-                    if (subStr.isEmpty())
-                    {
-                        cursor.movePosition (QTextCursor::StartOfBlock);
-                        endPos = cursor.position();
-                        if (!cursor.movePosition (QTextCursor::PreviousBlock))
-                            return QTextCursor();
-                        cursor.movePosition (QTextCursor::EndOfBlock);
-                        ++i;
-                    }
-                    else
-                    {
-                        if (!findBackward (txtdoc, subStr, cursor, flags))
-                            return QTextCursor();
-                        /* if the match doesn't start the block... */
-                        while (cursor.anchor() > cursor.block().position())
-                        {
-                            /* ... move the cursor to left and search backward until a match is found */
-                            cursor.setPosition (cursor.block().position() + subStr.count());
-                            if (!findBackward (txtdoc, subStr, cursor, flags))
-                                return QTextCursor();
-                        }
-
-                        endPos = cursor.position();
-                        if (!cursor.movePosition (QTextCursor::PreviousBlock))
-                            return QTextCursor();
-                        cursor.movePosition (QTextCursor::EndOfBlock);
-                        ++i;
-                    }
-                }
-                else if (i != sl.count() - 1) // the middle strings
-                {
-                    if (QString::compare (cursor.block().text(), sl.at (sl.count() - i - 1), cs) != 0)
-                    { // reset the loop if the block text doesn't match
-                        cursor.setPosition (endPos);
-                        if (!cursor.movePosition (QTextCursor::PreviousBlock))
-                            return QTextCursor();
-                        cursor.movePosition (QTextCursor::EndOfBlock);
-                        i = 0;
-                        continue;
-                    }
-
-                    if (!cursor.movePosition (QTextCursor::PreviousBlock))
-                        return QTextCursor();
-                    cursor.movePosition (QTextCursor::EndOfBlock);
-                    ++i;
-                }
-                else // the first string
-                {
-                    subStr = sl.at (0);
-                    if (subStr.isEmpty()) break;
-                    if (!(flags & QTextDocument::FindWholeWords))
-                    {
-                        /* when the first string doesn't end the previous block... */
-                        if (!cursor.block().text().endsWith (subStr, cs))
-                        {
-                            /* ... reset the loop */
-                            cursor.setPosition (endPos);
-                            if (!cursor.movePosition (QTextCursor::PreviousBlock))
-                                return QTextCursor();
-                            cursor.movePosition (QTextCursor::EndOfBlock);
-                            i = 0;
-                            continue;
-                        }
-                        cursor.setPosition (cursor.anchor() - subStr.count());
-                        break;
-                    }
-                    else
-                    {
-                        found = cursor; // block end
-                        if (!findBackward (txtdoc, subStr, found, flags)
-                            || found.position() != cursor.position())
-                        {
-                            cursor.setPosition (endPos);
-                            if (!cursor.movePosition (QTextCursor::PreviousBlock))
-                                return QTextCursor();
-                            cursor.movePosition (QTextCursor::EndOfBlock);
-                            i = 0;
-                            continue;
-                        }
-                        cursor.setPosition (found.anchor());
-                        break;
-                    }
-                }
-            }
-            res.setPosition (cursor.anchor());
-            res.setPosition (endPos, QTextCursor::KeepAnchor);
-        }
+        index = search.indexIn (text, start.isNull() ? 0 : start.selectionEnd());
+        if (index == -1 || (end > 0 && index > end))
+            return QTextCursor();
     }
-    else // there's no line break
+    else
     {
-        if (!(flags & QTextDocument::FindBackward))
-        {
-            res = txtdoc->find (str, start, flags);
-            if (end > 0 && res.anchor() > end)
-                return QTextCursor();
-        }
-        else
-            findBackward (txtdoc, str, res, flags);
+        if (start.isNull()) return QTextCursor();
+        index = search.lastIndexIn (text, start.anchor() - search.length());
+        if (index == -1)
+            return QTextCursor();
     }
 
+    QTextCursor res (textEdit->document());
+    res.setPosition (index);
+    res.setPosition (index + search.length(), QTextCursor::KeepAnchor);
     return res;
 }
 /*************************/
+// Searches the lines of a huge file that are outside the current page and, if the
+// string is found, loads the page containing it and returns the match in that page.
+QTextCursor FPwin::findInPagedFile (TextEdit *textEdit, const QString& str, bool forward) const
+{
+    PagedFile *pagedFile = textEdit->getPagedFile();
+    /* the lines of a paged file are searched only for literal strings */
+    if (pagedFile == nullptr || str.isEmpty() || isRegexSearch())
+        return QTextCursor();
+
+    QTextDocument::FindFlags flags = getSearchFlags();
+    Qt::CaseSensitivity cs = !(flags & QTextDocument::FindCaseSensitively)
+                             ? Qt::CaseInsensitive : Qt::CaseSensitive;
+    bool wholeWords = flags & QTextDocument::FindWholeWords;
+    const int first = textEdit->getFirstLine();
+    const int last = first + textEdit->document()->blockCount();
+    int line;
+    if (forward)
+    { // after the page and then, from the start of the file
+        line = pagedFile->findLine (str, last, pagedFile->lineCount(), false, cs, wholeWords);
+        if (line == -1)
+            line = pagedFile->findLine (str, 0, first, false, cs, wholeWords);
+    }
+    else
+    { // before the page and then, from the end of the file
+        line = pagedFile->findLine (str, 0, first, true, cs, wholeWords);
+        if (line == -1)
+            line = pagedFile->findLine (str, last, pagedFile->lineCount(), true, cs, wholeWords);
+    }
+    if (line == -1)
+        return QTextCursor();
+
+    textEdit->loadLine (line);
+    QTextDocument *txtdoc = textEdit->document();
+    QTextCursor start (txtdoc);
+    if (forward)
+        start.setPosition (txtdoc->findBlockByNumber (line - textEdit->getFirstLine()).position());
+    else
+    { // put the cursor at the end of the last line of the match
+        QTextBlock block = txtdoc->findBlockByNumber (line - textEdit->getFirstLine()
+                                                      + str.count (QLatin1Char ('\n')));
+        if (!block.isValid())
+            block = txtdoc->lastBlock();
+        start.setPosition (block.position() + block.length() - 1);
+        flags |= QTextDocument::FindBackward;
+    }
+    return finding (str, start, flags);
+}
+/*************************/
 void FPwin::find (bool forward)
 {
     if (!isReady()) return;
@@ -343,6 +134,11 @@ void FPwin::find (bool forward)
     disconnect (textEdit, &TextEdit::resized, this, &FPwin::hlight);
     disconnect (textEdit, &TextEdit::updateRect, this, &FPwin::hlighting);
     disconnect (textEdit, &QPlainTextEdit::textChanged, this, &FPwin::hlight);
+    disconnect (textEdit->searchIndex(), &SearchIndex::indexed, this, &FPwin::hlight);
+
+    QTextDocument::FindFlags searchFlags = getSearchFlags();
+    /* all matches are found in the background for highlighting them */
+    textEdit->searchIndex()->setQuery (txt, searchFlags, isRegexSearch());
 
     if (txt.isEmpty())
     {
@@ -356,29 +152,43 @@ void FPwin::find (bool forward)
         return;
     }
 
-    QTextDocument::FindFlags searchFlags = getSearchFlags();
-    QTextDocument::FindFlags newFlags = searchFlags;
-    if (!forward)
-        newFlags = searchFlags | QTextDocument::FindBackward;
-    QTextCursor start = textEdit->textCursor();
-    QTextCursor found = finding (txt, start, newFlags);
-
-    if (found.isNull())
+    if (isRegexSearch())
+    { // the match will be selected when it's found (-> regexMatched())
+        startRegexSearch (textEdit, txt, forward ? RegexMatcher::Forward : RegexMatcher::Backward, REGEX_FIND);
+    }
+    else
     {
+        QTextDocument::FindFlags newFlags = searchFlags;
         if (!forward)
-            start.movePosition (QTextCursor::End, QTextCursor::MoveAnchor);
-        else
-            start.movePosition (QTextCursor::Start, QTextCursor::MoveAnchor);
-        found = finding (txt, start, newFlags);
-    }
+            newFlags = searchFlags | QTextDocument::FindBackward;
+        QTextCursor start = textEdit->textCursor();
+        QTextCursor found = finding (txt, start, newFlags);
 
-    if (!found.isNull())
-    {
-        start.setPosition (found.anchor());
-        /* this is needed for selectionChanged() to be emitted */
-        if (newSrch) textEdit->setTextCursor (start);
-        start.setPosition (found.position(), QTextCursor::KeepAnchor);
-        textEdit->setTextCursor (start);
+        if (found.isNull() && textEdit->getPagedFile())
+        { // search the other pages of a huge file
+            waitToMakeBusy();
+            found = findInPagedFile (textEdit, txt, forward);
+            unbusy();
+            start = textEdit->textCursor(); // the page may have changed
+        }
+
+        if (found.isNull())
+        {
+            if (!forward)
+                start.movePosition (QTextCursor::End, QTextCursor::MoveAnchor);
+            else
+                start.movePosition (QTextCursor::Start, QTextCursor::MoveAnchor);
+            found = finding (txt, start, newFlags);
+        }
+
+        if (!found.isNull())
+        {
+            start.setPosition (found.anchor());
+            /* this is needed for selectionChanged() to be emitted */
+            if (newSrch) textEdit->setTextCursor (start);
+            start.setPosition (found.position(), QTextCursor::KeepAnchor);
+            textEdit->setTextCursor (start);
+        }
     }
     /* matches highlights should come here, after the text area is
        scrolled and even when no match is found (it may be added later) */
@@ -386,6 +196,7 @@ void FPwin::find (bool forward)
     connect (textEdit, &QPlainTextEdit::textChanged, this, &FPwin::hlight);
     connect (textEdit, &TextEdit::updateRect, this, &FPwin::hlighting);
     connect (textEdit, &TextEdit::resized, this, &FPwin::hlight);
+    connect (textEdit->searchIndex(), &SearchIndex::indexed, this, &FPwin::hlight);
 }
 /*************************/
 // Highlight found matches in the visible part of the text.
@@ -401,44 +212,71 @@ void FPwin::hlight() const
     if (txt.isEmpty()) return;
 
     QTextDocument::FindFlags searchFlags = getSearchFlags();
+    const bool regex = isRegexSearch();
 
     /* prepend green highlights */
     QList<QTextEdit::ExtraSelection> es = textEdit->getGreenSel();
     QColor color = QColor (textEdit->hasDarkScheme() ? QColor (115, 115, 0) : Qt::yellow);
-    QTextCursor found;
     /* first put a start cursor at the top left edge... */
     QPoint Point (0, 0);
     QTextCursor start = textEdit->cursorForPosition (Point);
-    /* ... then move it backward by the search text length */
-    int startPos = start.position() - txt.length();
-    if (startPos >= 0)
-        start.setPosition (startPos);
-    else
-        start.setPosition (0);
+    /* ... then move it backward by the search text length
+       and one more character (for checking whole words) */
+    int startPos = qMax (start.position() - txt.length(), 0);
+    start.setPosition (qMax (startPos - 1, 0));
+    /* get the end of the visible text */
     int w = textEdit->geometry().width();
     int h = textEdit->geometry().height();
-    /* get the visible text to check if
-       the search string is inside it */
     Point = QPoint (w, h);
     QTextCursor end = textEdit->cursorForPosition (Point);
     int endLimit = end.anchor();
-    int endPos = end.position() + txt.length();
-    end.movePosition (QTextCursor::End);
-    if (endPos <= end.position())
-        end.setPosition (endPos);
-    QTextCursor visCur = start;
-    visCur.setPosition (end.position(), QTextCursor::KeepAnchor);
-    QString str = visCur.selection().toPlainText(); // '\n' is included in this way
-    Qt::CaseSensitivity cs = Qt::CaseInsensitive;
-    if (tabPage->matchCase()) cs = Qt::CaseSensitive;
-    while (str.contains (txt, cs) // don't waste time if the searched text isn't visible
-           && !(found = finding (txt, start, searchFlags, endLimit)).isNull())
-    {
-        QTextEdit::ExtraSelection extra;
-        extra.format.setBackground (color);
-        extra.cursor = found;
-        es.append (extra);
-        start.setPosition (found.position());
+
+    SearchIndex *searchIndex = textEdit->searchIndex();
+    if (searchIndex->isReady (txt, searchFlags, regex))
+    { // find the visible matches in the index of all matches
+        const QVector<int> &matches = searchIndex->matches();
+        QVector<int>::const_iterator it = std::lower_bound (matches.constBegin(), matches.constEnd(), startPos);
+        /* a regex match may start far before the visible text */
+        if (regex && it != matches.constBegin()
+            && *(it - 1) + searchIndex->matchLength (static_cast<int>(it - 1 - matches.constBegin())) > startPos)
+        {
+            --it;
+        }
+        for (; it != matches.constEnd() && *it <= endLimit; ++it)
+        {
+            QTextCursor found = start;
+            found.setPosition (*it);
+            found.setPosition (*it + searchIndex->matchLength (static_cast<int>(it - matches.constBegin())),
+                               QTextCursor::KeepAnchor);
+            QTextEdit::ExtraSelection extra;
+            extra.format.setBackground (color);
+            extra.cursor = found;
+            es.append (extra);
+        }
+    }
+    else if (!regex)
+    { // search in the visible text while all matches are being found (not with a regex)
+        int endPos = end.position() + txt.length() + 1;
+        end.movePosition (QTextCursor::End);
+        if (endPos <= end.position())
+            end.setPosition (endPos);
+        QTextCursor visCur = start;
+        visCur.setPosition (end.position(), QTextCursor::KeepAnchor);
+        QString str = visCur.selection().toPlainText(); // '\n' is included in this way
+        TextSearch search (txt, searchFlags);
+        const int offset = start.position();
+        int i = startPos - offset;
+        while ((i = search.indexIn (str, i)) != -1 && offset + i <= endLimit)
+        {
+            QTextCursor found = start;
+            found.setPosition (offset + i);
+            found.setPosition (offset + i + search.length(), QTextCursor::KeepAnchor);
+            QTextEdit::ExtraSelection extra;
+            extra.format.setBackground (color);
+            extra.cursor = found;
+            es.append (extra);
+            i += search.length();
+        }
     }
 
     /* also prepend the current line highlight,
@@ -462,6 +300,9 @@ void FPwin::searchFlagChanged()
     int index = ui->tabWidget->currentIndex();
     if (index == -1) return;
 
+    /* the result of a regex search is for the previous flags */
+    regexMatcher_->cancel();
+
     /* deselect text for consistency */
     TextEdit *textEdit = qobject_cast< TabPage *>(ui->tabWidget->widget (index))->textEdit();
     QTextCursor start = textEdit->textCursor();
@@ -471,9 +312,109 @@ void FPwin::searchFlagChanged()
         textEdit->setTextCursor (start);
     }
 
+    textEdit->searchIndex()->setQuery (textEdit->getSearchedText(), getSearchFlags(), isRegexSearch());
     hlight();
 }
 /*************************/
+// Starts searching a snapshot of the text for a regex (-> regexMatched()).
+// Only one regex is searched at a time because a long match can't be interrupted.
+void FPwin::startRegexSearch (TextEdit *textEdit, const QString& pattern, RegexMatcher::Mode mode, REGEXTASK task)
+{
+    if (regexMatcher_->isBusy())
+    {
+        showRegexMessage (tr ("Still searching..."), task);
+        return;
+    }
+    RegexSearch search (pattern, getSearchFlags());
+    if (!search.isValid())
+    {
+        showRegexMessage (tr ("Invalid Regular Expression"), task);
+        return;
+    }
+    QTextCursor cur = textEdit->textCursor();
+    int pos = 0;
+    if (mode == RegexMatcher::Forward)
+        pos = cur.selectionEnd();
+    else if (mode == RegexMatcher::Backward)
+        pos = cur.anchor();
+    regexTask_ = task;
+    regexTextEdit_ = textEdit;
+    regexRevision_ = textEdit->document()->revision();
+    /* as with literal strings, only finding wraps around */
+    regexMatcher_->start (search, textEdit->textSnapshot(), mode, pos, task == REGEX_FIND);
+}
+/*************************/
+// Shows a message in the search bar or, for replacements, in the replace dock.
+void FPwin::showRegexMessage (const QString& message, REGEXTASK task)
+{
+    TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget());
+    if (tabPage == nullptr) return;
+    if (task == REGEX_FIND)
+        tabPage->showSearchMessage (message);
+    else
+    {
+        ui->dockReplace->setWindowTitle (message);
+        tabPage->textEdit()->setReplaceTitle (message);
+    }
+}
+/*************************/
+// The result of a regex search is used only if its document is current and unchanged.
+void FPwin::regexMatched (const QVector<QRegularExpressionMatch>& matches)
+{
+    const REGEXTASK task = regexTask_;
+    regexTask_ = NO_REGEX_TASK;
+    TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget());
+    if (tabPage == nullptr || regexTextEdit_.isNull() || tabPage->textEdit() != regexTextEdit_
+        || regexTextEdit_->document()->revision() != regexRevision_)
+    {
+        return;
+    }
+    TextEdit *textEdit = regexTextEdit_;
+
+    if (task == REGEX_FIND)
+    {
+        if (matches.isEmpty()) return;
+        QTextCursor start = textEdit->textCursor();
+        start.setPosition (matches.first().capturedStart());
+        /* this is needed for selectionChanged() to be emitted */
+        textEdit->setTextCursor (start);
+        start.setPosition (matches.first().capturedEnd(), QTextCursor::KeepAnchor);
+        textEdit->setTextCursor (start);
+        hlight();
+    }
+    else if (task == REGEX_REPLACE && !textEdit->isReadOnly())
+    {
+        QTextCursor found;
+        QString replacement = txtReplace_;
+        if (!matches.isEmpty())
+        {
+            found = QTextCursor (textEdit->document());
+            found.setPosition (matches.first().capturedStart());
+            found.setPosition (matches.first().capturedEnd(), QTextCursor::KeepAnchor);
+            replacement = RegexSearch::substituted (txtReplace_, matches.first());
+        }
+        replaceFound (textEdit, found, replacement);
+    }
+    else if (task == REGEX_REPLACE_ALL && !textEdit->isReadOnly())
+    { // the captured texts are substituted in each replacement
+        QVector<int> starts, lengths;
+        QStringList replacements;
+        for (const QRegularExpressionMatch &match : matches)
+        {
+            starts.append (match.capturedStart());
+            lengths.append (match.capturedLength());
+            replacements.append (RegexSearch::substituted (txtReplace_, match));
+        }
+        replaceAllMatches (textEdit, starts, lengths, replacements);
+    }
+}
+/*************************/
+void FPwin::regexTimedOut()
+{
+    showRegexMessage (tr ("Search Timed Out"), regexTask_);
+    regexTask_ = NO_REGEX_TASK;
+}
+/*************************/
 QTextDocument::FindFlags FPwin::getSearchFlags() const
 {
     TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget());
@@ -484,5 +425,11 @@ QTextDocument::FindFlags FPwin::getSearchFlags() const
         searchFlags |= QTextDocument::FindCaseSensitively;
     return searchFlags;
 }
+/*************************/
+bool FPwin::isRegexSearch() const
+{
+    TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget());
+    return tabPage != nullptr && tabPage->matchRegex();
+}
 
 }
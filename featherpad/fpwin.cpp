@@ -26,6 +26,7 @@
 #include "pref.h"
 #include "session.h"
 #include "loading.h"
+#include "streaming.h"
 #include "warningbar.h"
 #include "svgicons.h"
 
@@ -40,11 +41,23 @@
 #include <QProcess>
 #include <QTextDocumentWriter>
 #include <QTextCodec>
+#include <QProgressBar>
+#include <QDateTime>
 
 #include "x11.h"
 
 namespace FeatherPad {
 
+/* Texts with more characters are set chunk by chunk. */
+static const int STREAMING_SIZE = 1024*1024;
+/* The maximum number of characters in each streamed chunk. */
+static const int STREAMING_CHUNK = 256*1024;
+/* The time (in ms) that streaming may take in each event loop iteration. */
+static const int STREAMING_TIME = 20;
+/* The maximum number of files that are loaded at the same time
+   (more threads would only compete for the disk). */
+static const int MAX_LOADINGS = 4;
+
 void BusyMaker::waiting() {
     QTimer::singleShot (timeout, this, SLOT (makeBusy()));
 }
@@ -61,14 +74,25 @@ FPwin::FPwin (QWidget *parent):QMainWindow (parent), dummyWidget (nullptr), ui (
     ui->setupUi (this);
 
     loadingProcesses_ = 0;
+    nextSeq_ = deliverSeq_ = 0;
+    requestedFiles_ = openedFiles_ = 0;
+    currentTabClaimed_ = false;
     rightClicked_ = -1;
     busyThread_ = nullptr;
 
     autoSaver_ = nullptr;
     autoSaverRemainingTime_ = -1;
 
+    streamer_ = nullptr;
+
     sidePane_ = nullptr;
 
+    regexMatcher_ = new RegexMatcher (this);
+    regexTask_ = NO_REGEX_TASK;
+    regexRevision_ = 0;
+    connect (regexMatcher_, &RegexMatcher::matched, this, &FPwin::regexMatched);
+    connect (regexMatcher_, &RegexMatcher::timedOut, this, &FPwin::regexTimedOut);
+
     /* "Jump to" bar */
     ui->spinBox->hide();
     ui->label->hide();
@@ -895,13 +919,15 @@ void FPwin::deleteTabPage (int tabIndex)
         }
     }
     TextEdit *textEdit = tabPage->textEdit();
-    if (textEdit->getSaveCursor())
+    if (textEdit->getSaveCursor()
+        && (!textEdit->isLazy() || textEdit->isEvicted())) // otherwise, the saved position is still valid
     {
         QString fileName = textEdit->getFileName();
         if (!fileName.isEmpty())
         {
             Config& config = static_cast<FPsingleton*>(qApp)->getConfig();
-            config.saveCursorPos (fileName, textEdit->textCursor().position());
+            config.saveCursorPos (fileName, textEdit->isEvicted() ? textEdit->getEvictedPos()
+                                                                  : textEdit->textCursor().position());
         }
     }
     /* because deleting the syntax highlighter changes the text,
@@ -1661,9 +1687,7 @@ void FPwin::executeProcess()
 /*************************/
 bool FPwin::isScriptLang (QString lang)
 {
-    return (lang == "sh" || lang == "python"
-            || lang == "ruby" || lang == "lua"
-            || lang == "perl");
+    return (languageFlags (languageId (lang)) & isScript);
 }
 /*************************/
 void FPwin::exitProcess()
@@ -1957,19 +1981,58 @@ void FPwin::unbusy()
         QGuiApplication::restoreOverrideCursor();
 }
 /*************************/
+// Files are queued and loaded by a limited number of threads. A file that isn't
+// one of multiple files (usually, opened by the user or reloaded) comes first
+// and its text is added as soon as possible. So does the first of multiple files
+// if it will be opened in the current (unused) tab, as in restoring a session.
+// The texts of other files are added in the order of their requests, so that
+// their tabs keep that order.
 void FPwin::loadText (const QString& fileName, bool enforceEncod, bool reload,
                       bool saveCursor, bool enforceUneditable, bool multiple)
 {
     if (loadingProcesses_ == 0)
+    {
         closeWarningBar();
+        requestedFiles_ = openedFiles_ = 0;
+        currentTabClaimed_ = false;
+    }
+    bool first = false; // will the text be opened in the current tab?
+    if (!currentTabClaimed_ && !reload && !enforceEncod)
+    {
+        TabPage *tabPage = qobject_cast<TabPage*>(ui->tabWidget->currentWidget());
+        if (tabPage == nullptr)
+            first = true;
+        else
+        {
+            TextEdit *textEdit = tabPage->textEdit();
+            first = textEdit->document()->isEmpty()
+                    && !textEdit->document()->isModified()
+                    && textEdit->getFileName().isEmpty();
+        }
+        currentTabClaimed_ = first;
+    }
     ++ loadingProcesses_;
-    QString charset;
+    ++ requestedFiles_;
+    fileLoading fl;
+    fl.fileName = fileName;
     if (enforceEncod)
-        charset = checkToEncoding();
-    Loading *thread = new Loading (fileName, charset, reload, saveCursor, enforceUneditable, multiple);
-    connect (thread, &Loading::completed, this, &FPwin::addText);
-    connect (thread, &Loading::finished, thread, &QObject::deleteLater);
-    thread->start();
+        fl.charset = checkToEncoding();
+    fl.reload = reload;
+    fl.saveCursor = saveCursor;
+    fl.enforceUneditable = enforceUneditable;
+    fl.multiple = multiple;
+    if (multiple && !first)
+    {
+        fl.seq = nextSeq_++;
+        pendingLoadings_.append (fl);
+    }
+    else
+    {
+        fl.seq = -1;
+        pendingLoadings_.prepend (fl);
+    }
+    startLoadings();
+    showLoadingProgress();
 
     if (QGuiApplication::overrideCursor() == nullptr)
         waitToMakeBusy();
@@ -1977,11 +2040,100 @@ void FPwin::loadText (const QString& fileName, bool enforceEncod, bool reload,
     updateShortcuts (true, false);
 }
 /*************************/
+void FPwin::startLoadings()
+{
+    while (runningLoadings_.size() < MAX_LOADINGS && !pendingLoadings_.isEmpty())
+    {
+        const fileLoading fl = pendingLoadings_.takeFirst();
+        Loading *thread = new Loading (fl.fileName, fl.charset, fl.reload,
+                                       fl.saveCursor, fl.enforceUneditable, fl.multiple);
+        runningLoadings_.insert (thread, fl.seq);
+        connect (thread, &Loading::completed, this, &FPwin::onLoaded);
+        connect (thread, &Loading::finished, this, [this, thread]() {
+            runningLoadings_.remove (thread);
+            startLoadings();
+        });
+        connect (thread, &Loading::finished, thread, &QObject::deleteLater);
+        thread->start();
+    }
+}
+/*************************/
+void FPwin::onLoaded (const QString& text, const QString& fileName, const QString& charset,
+                      bool enforceEncod, bool reload, bool saveCursor,
+                      bool uneditable, bool multiple,
+                      const QSharedPointer<PagedFile>& pagedFile, const LineIndex& lineIndex, bool uncertainCharset)
+{
+    ++ openedFiles_;
+    int seq = runningLoadings_.value (sender(), -1);
+    if (seq < 0)
+    {
+        addText (text, fileName, charset, enforceEncod, reload, saveCursor,
+                 uneditable, multiple, pagedFile, lineIndex, uncertainCharset);
+        showLoadingProgress();
+        return;
+    }
+
+    loadedText lt;
+    lt.text = text;
+    lt.fileName = fileName;
+    lt.charset = charset;
+    lt.enforceEncod = enforceEncod;
+    lt.reload = reload;
+    lt.saveCursor = saveCursor;
+    lt.uneditable = uneditable;
+    lt.multiple = multiple;
+    lt.pagedFile = pagedFile;
+    lt.lineIndex = lineIndex;
+    lt.uncertainCharset = uncertainCharset;
+    loadedTexts_.insert (seq, lt);
+    deliverLoadedTexts();
+}
+/*************************/
+// Adds the next text in the order of requests if it's loaded, but
+// only one text in each cycle of the event loop, not to flood the GUI.
+void FPwin::deliverLoadedTexts()
+{
+    if (!loadedTexts_.contains (deliverSeq_)) return;
+    const loadedText lt = loadedTexts_.take (deliverSeq_);
+    ++ deliverSeq_;
+    addText (lt.text, lt.fileName, lt.charset, lt.enforceEncod, lt.reload, lt.saveCursor,
+             lt.uneditable, lt.multiple, lt.pagedFile, lt.lineIndex, lt.uncertainCharset);
+    showLoadingProgress();
+    if (loadedTexts_.contains (deliverSeq_))
+        QTimer::singleShot (0, this, &FPwin::deliverLoadedTexts);
+}
+/*************************/
+void FPwin::showLoadingProgress()
+{
+    QProgressBar *bar = ui->statusBar->findChild<QProgressBar *>("loadingBar");
+    if (loadingProcesses_ == 0 || requestedFiles_ < 2 || !ui->statusBar->isVisible())
+    {
+        if (bar)
+            bar->setVisible (false);
+        return;
+    }
+
+    if (bar == nullptr)
+    {
+        bar = new QProgressBar();
+        bar->setObjectName ("loadingBar");
+        bar->setMaximumWidth (150);
+        bar->setFormat (tr ("Files") + " %v/%m");
+        ui->statusBar->addPermanentWidget (bar);
+    }
+    bar->setRange (0, requestedFiles_);
+    bar->setValue (openedFiles_);
+    bar->setVisible (true);
+}
+/*************************/
 // When multiple files are being loaded, we don't change the current tab.
 void FPwin::addText (const QString& text, const QString& fileName, const QString& charset,
                      bool enforceEncod, bool reload, bool saveCursor,
                      bool uneditable,
-                     bool multiple)
+                     bool multiple,
+                     const QSharedPointer<PagedFile>& pagedFile,
+                     const LineIndex& lineIndex,
+                     bool uncertainCharset)
 {
     if (fileName.isEmpty() || charset.isEmpty())
     {
@@ -1990,7 +2142,7 @@ void FPwin::addText (const QString& text, const QString& fileName, const QString
         else
             connect (this, &FPwin::finishedLoading, this, &FPwin::onPermissionDenied, Qt::UniqueConnection);
         -- loadingProcesses_; // can never become negative
-        if (!isLoading())
+        if (loadingProcesses_ == 0) // huge texts may still be streamed
         {
             unbusy();
             ui->tabWidget->tabBar()->lockTabs (false);
@@ -2018,6 +2170,7 @@ void FPwin::addText (const QString& text, const QString& fileName, const QString
     bool openInCurrentTab (true);
     if (!reload
         && !enforceEncod
+        && !(textEdit->isLazy() && textEdit->getFileName() == fileName) // a restored file is activated
         && (!textEdit->document()->isEmpty()
             || textEdit->document()->isModified()
             || !textEdit->getFileName().isEmpty()))
@@ -2028,7 +2181,7 @@ void FPwin::addText (const QString& text, const QString& fileName, const QString
     }
     else
     {
-        if (sidePane_ && !reload && !enforceEncod) // an unused empty tab
+        if (sidePane_ && !reload && !enforceEncod && !textEdit->isLazy()) // an unused empty tab
             scrollToFirstItem = true;
         /*if (isMinimized())
             setWindowState (windowState() & (~Qt::WindowMinimized | Qt::WindowActive));*/
@@ -2081,26 +2234,61 @@ void FPwin::addText (const QString& text, const QString& fileName, const QString
     int scrollbarValue = -1;
     if (reload)
     {
-        pos = textEdit->textCursor().position();
-        anchor = textEdit->textCursor().anchor();
-        if (QScrollBar *scrollbar = textEdit->verticalScrollBar())
+        if (textEdit->isEvicted())
+        { // the document was released
+            pos = textEdit->getEvictedPos();
+            anchor = textEdit->getEvictedAnchor();
+            scrollbarValue = textEdit->getEvictedScrollValue();
+        }
+        else
         {
-            if (scrollbar->isVisible())
-                scrollbarValue = scrollbar->value();
+            pos = textEdit->textCursor().position();
+            anchor = textEdit->textCursor().anchor();
+            if (QScrollBar *scrollbar = textEdit->verticalScrollBar())
+            {
+                if (scrollbar->isVisible())
+                    scrollbarValue = scrollbar->value();
+            }
         }
     }
 
     /* set the text */
     disconnect (textEdit->document(), &QTextDocument::modificationChanged, ui->actionSave, &QAction::setEnabled);
     disconnect (textEdit->document(), &QTextDocument::modificationChanged, this, &FPwin::asterisk);
-    textEdit->setPlainText (text);
-    connect (textEdit->document(), &QTextDocument::modificationChanged, ui->actionSave, &QAction::setEnabled);
-    connect (textEdit->document(), &QTextDocument::modificationChanged, this, &FPwin::asterisk);
+    textEdit->setPagedFile (pagedFile); // the text is a page of a huge file or nothing
+    textEdit->setLineIndex (lineIndex);
+    /* a huge text is set in chunks, so that the first screen can be
+       shown at once and the GUI isn't frozen while the rest is added */
+    int streamPos = text.size();
+    if (streamPos > STREAMING_SIZE && pagedFile.isNull())
+    {
+        streamPos = streamingChunkEnd (text, 0, STREAMING_SIZE);
+        textEdit->setPlainText (text.left (streamPos));
+        textEdit->document()->setUndoRedoEnabled (false); // the chunks shouldn't be undone
+    }
+    else
+    {
+        textEdit->setPlainText (text);
+        connect (textEdit->document(), &QTextDocument::modificationChanged, ui->actionSave, &QAction::setEnabled);
+        connect (textEdit->document(), &QTextDocument::modificationChanged, this, &FPwin::asterisk);
+    }
+    bool streaming (streamPos < text.size());
 
     Config& config = static_cast<FPsingleton*>(qApp)->getConfig();
 
-    /* now, restore the cursor */
-    if (reload)
+    /* now, restore the cursor (after the whole text is set if it's streamed) */
+    if (streaming && (reload || saveCursor))
+    {
+        if (!reload)
+        {
+            QHash<QString, QVariant> cursorPos = config.savedCursorPos();
+            if (cursorPos.contains (fileName))
+                pos = anchor = qMax (cursorPos.value (fileName, 0).toInt(), 0);
+            else
+                pos = anchor = -1;
+        }
+    }
+    else if (reload)
     {
         QTextCursor cur = textEdit->textCursor();
         cur.movePosition (QTextCursor::End, QTextCursor::MoveAnchor);
@@ -2126,6 +2314,8 @@ void FPwin::addText (const QString& text, const QString& fileName, const QString
     }
 
     textEdit->setFileName (fileName);
+    textEdit->setLazy (false);
+    textEdit->setLastVisit (QDateTime::currentMSecsSinceEpoch());
     textEdit->setSize (fInfo.size());
     textEdit->setLastModified (fInfo.lastModified());
     lastFile_ = fileName;
@@ -2133,11 +2323,18 @@ void FPwin::addText (const QString& text, const QString& fileName, const QString
         config.addRecentFile (lastFile_);
     textEdit->setEncoding (charset);
     textEdit->setWordNumber (-1);
-    if (uneditable)
+    if (pagedFile)
+    {
+        connect (this, &FPwin::finishedLoading, this, &FPwin::onOpeningPagedFiles, Qt::UniqueConnection);
+        textEdit->makeUneditable (true);
+    }
+    else if (uneditable)
     {
         connect (this, &FPwin::finishedLoading, this, &FPwin::onOpeningUneditable, Qt::UniqueConnection);
         textEdit->makeUneditable (uneditable);
     }
+    if (uncertainCharset && !enforceEncod)
+        connect (this, &FPwin::finishedLoading, this, &FPwin::onUncertainEncoding, Qt::UniqueConnection);
     setProgLang (textEdit);
     if (ui->actionSyntax->isChecked())
         syntaxHighlighting (textEdit);
@@ -2157,7 +2354,8 @@ void FPwin::addText (const QString& text, const QString& fileName, const QString
             wi->setToolTip (elidedTip);
     }
 
-    if (uneditable || alreadyOpen (tabPage))
+    bool keepReadOnly (uneditable || alreadyOpen (tabPage));
+    if (keepReadOnly)
     {
         textEdit->setReadOnly (true);
         if (!textEdit->hasDarkScheme())
@@ -2196,9 +2394,33 @@ void FPwin::addText (const QString& text, const QString& fileName, const QString
         disconnect (textEdit, &QPlainTextEdit::copyAvailable, ui->actionCut, &QAction::setEnabled);
         disconnect (textEdit, &QPlainTextEdit::copyAvailable, ui->actionDelete, &QAction::setEnabled);
     }
-    else if (textEdit->isReadOnly())
+    else if (textEdit->isReadOnly() && !streaming)
         QTimer::singleShot (0, this, SLOT (makeEditable()));
 
+    if (streaming)
+    {
+        streamingText st;
+        st.textEdit = textEdit;
+        st.text = text;
+        st.pos = streamPos;
+        st.cursorPos = (reload || saveCursor) ? pos : -1;
+        st.cursorAnchor = (reload || saveCursor) ? anchor : -1;
+        st.scrollbarValue = scrollbarValue;
+        st.readOnly = keepReadOnly;
+        st.makeEditable = !keepReadOnly && textEdit->isReadOnly();
+        streamingTexts_.append (st);
+        scrollbarValue = -1; // it'll be restored when the whole text is set
+        textEdit->setReadOnly (true); // no editing until the whole text is set
+        if (streamer_ == nullptr)
+        {
+            streamer_ = new QTimer (this);
+            connect (streamer_, &QTimer::timeout, this, &FPwin::streamText);
+        }
+        if (!streamer_->isActive())
+            streamer_->start (0);
+        showStreamingProgress();
+    }
+
     if (!multiple || openInCurrentTab)
     {
         if (ui->statusBar->isVisible())
@@ -2224,9 +2446,9 @@ void FPwin::addText (const QString& text, const QString& fileName, const QString
         }
     }
 
-    /* a file is completely loaded */
+    /* a file is completely loaded (but its text may still be streamed) */
     -- loadingProcesses_;
-    if (!isLoading())
+    if (loadingProcesses_ == 0)
     {
         unbusy();
         ui->tabWidget->tabBar()->lockTabs (false);
@@ -2257,6 +2479,103 @@ void FPwin::addText (const QString& text, const QString& fileName, const QString
     }
 }
 /*************************/
+// Add the next chunks of the streamed texts to their documents
+// but give the event loop a chance to process other events.
+void FPwin::streamText()
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!streamingTexts_.isEmpty() && timer.elapsed() < STREAMING_TIME)
+    {
+        streamingText &st = streamingTexts_.first();
+        if (st.textEdit.isNull())
+        {
+            streamingTexts_.removeFirst();
+            continue;
+        }
+
+        /* end the chunk after a line break if possible */
+        int end = streamingChunkEnd (st.text, st.pos, st.pos + STREAMING_CHUNK);
+        QTextCursor cur (st.textEdit->document());
+        cur.movePosition (QTextCursor::End);
+        cur.insertText (st.text.mid (st.pos, end - st.pos));
+        st.pos = end;
+
+        if (st.pos >= st.text.size())
+        {
+            streamingText done = streamingTexts_.takeFirst();
+            finishStreaming (done.textEdit, done.cursorPos, done.cursorAnchor,
+                             done.scrollbarValue, done.readOnly, done.makeEditable);
+        }
+    }
+
+    if (streamingTexts_.isEmpty())
+        streamer_->stop();
+    showStreamingProgress();
+}
+/*************************/
+void FPwin::finishStreaming (TextEdit *textEdit, int pos, int anchor,
+                             int scrollbarValue, bool readOnly, bool editable)
+{
+    QTextDocument *doc = textEdit->document();
+    doc->setUndoRedoEnabled (true);
+    doc->setModified (false);
+    connect (doc, &QTextDocument::modificationChanged, ui->actionSave, &QAction::setEnabled);
+    connect (doc, &QTextDocument::modificationChanged, this, &FPwin::asterisk);
+
+    if (editable)
+        makeTextEditable (textEdit);
+    else if (!readOnly)
+        textEdit->setReadOnly (false);
+
+    if (pos > -1 && anchor > -1)
+    {
+        QTextCursor cur = textEdit->textCursor();
+        cur.movePosition (QTextCursor::End, QTextCursor::MoveAnchor);
+        int curPos = cur.position();
+        cur.setPosition (qMin (anchor, curPos));
+        cur.setPosition (qMin (pos, curPos), QTextCursor::KeepAnchor);
+        textEdit->setTextCursor (cur);
+    }
+    if (scrollbarValue > -1)
+    {
+        if (QScrollBar *scrollbar = textEdit->verticalScrollBar())
+        {
+            if (scrollbar->isVisible())
+                scrollbar->setValue (scrollbarValue);
+        }
+    }
+}
+/*************************/
+void FPwin::showStreamingProgress()
+{
+    QProgressBar *bar = ui->statusBar->findChild<QProgressBar *>("streamingBar");
+    if (streamingTexts_.isEmpty() || !ui->statusBar->isVisible())
+    {
+        if (bar)
+            bar->setVisible (false);
+        return;
+    }
+
+    if (bar == nullptr)
+    {
+        bar = new QProgressBar();
+        bar->setObjectName ("streamingBar");
+        bar->setRange (0, 100);
+        bar->setMaximumWidth (150);
+        bar->setFormat (tr ("Loading") + " %p%");
+        ui->statusBar->addPermanentWidget (bar);
+    }
+    qint64 total = 0, done = 0;
+    for (int i = 0; i < streamingTexts_.count(); ++i)
+    {
+        total += streamingTexts_.at (i).text.size();
+        done += streamingTexts_.at (i).pos;
+    }
+    bar->setValue (total > 0 ? static_cast<int>(100 * done / total) : 100);
+    bar->setVisible (true);
+}
+/*************************/
 void FPwin::disconnectLambda()
 {
     QObject::disconnect (lambdaConnection_);
@@ -2267,7 +2586,25 @@ void FPwin::onOpeningHugeFiles()
     disconnect (this, &FPwin::finishedLoading, this, &FPwin::onOpeningHugeFiles);
     QTimer::singleShot (100, this, [=]() { // TabWidget has a 50-ms timer
         showWarningBar ("<center><b><big>" + tr ("Huge file(s) not opened!") + "</big></b></center>\n"
-                        + "<center>" + tr ("FeatherPad does not open files larger than 100 MiB.") + "</center>");
+                        + "<center>" + tr ("They could not be mapped into memory.") + "</center>");
+    });
+}
+/*************************/
+void FPwin::onOpeningPagedFiles()
+{
+    disconnect (this, &FPwin::finishedLoading, this, &FPwin::onOpeningPagedFiles);
+    QTimer::singleShot (100, this, [=]() {
+        showWarningBar ("<center><b><big>" + tr ("Huge file(s) opened page by page!") + "</big></b></center>\n"
+                        + "<center>" + tr ("Files larger than 100 MiB are shown as read-only pages.") + "</center>");
+    });
+}
+/*************************/
+void FPwin::onUncertainEncoding()
+{
+    disconnect (this, &FPwin::finishedLoading, this, &FPwin::onUncertainEncoding);
+    QTimer::singleShot (100, this, [=]() {
+        showWarningBar ("<center><b><big>" + tr ("Encoding of some file(s) guessed!") + "</big></b></center>\n"
+                        + "<center>" + tr ("If a text isn't shown correctly, choose its encoding from the Encoding menu.") + "</center>");
     });
 }
 /*************************/
@@ -2352,6 +2689,40 @@ void FPwin::newTabFromName (const QString& fileName, bool saveCursor,
     }
 }
 /*************************/
+// Creates a tab for a restored file without loading the file.
+// The file will be loaded when the tab is activated for the first time.
+void FPwin::newLazyTab (const QString& fileName, bool saveCursor)
+{
+    if (fileName.isEmpty() || !QFileInfo (fileName).isFile())
+        return;
+    if (ui->tabWidget->currentIndex() == -1)
+    { // the first tab will be activated immediately
+        newTabFromName (fileName, saveCursor, false);
+        return;
+    }
+
+    TabPage *tabPage = createEmptyTab (false, false);
+    TextEdit *textEdit = tabPage->textEdit();
+    textEdit->setFileName (fileName);
+    textEdit->setSaveCursor (saveCursor);
+    textEdit->setLazy (true);
+    textEdit->setReadOnly (true); // until the file is loaded
+
+    int index = ui->tabWidget->indexOf (tabPage);
+    setTitle (fileName, index);
+    QString tip (QFileInfo (fileName).absolutePath() + "/");
+    QFontMetrics metrics (QToolTip::font());
+    int w = QApplication::desktop()->screenGeometry().width();
+    if (w > 200 * metrics.width (' ')) w = 200 * metrics.width (' ');
+    QString elidedTip = metrics.elidedText (tip, Qt::ElideMiddle, w);
+    ui->tabWidget->setTabToolTip (index, elidedTip);
+    if (!sideItems_.isEmpty())
+    {
+        if (QListWidgetItem *wi = sideItems_.key (tabPage))
+            wi->setToolTip (elidedTip);
+    }
+}
+/*************************/
 void FPwin::newTabFromRecent()
 {
     QAction *action = qobject_cast<QAction*>(QObject::sender());
@@ -2948,9 +3319,12 @@ void FPwin::makeEditable()
     int index = ui->tabWidget->currentIndex();
     if (index == -1) return;
 
-    TextEdit *textEdit = qobject_cast< TabPage *>(ui->tabWidget->widget (index))->textEdit();
-    bool textIsSelected = textEdit->textCursor().hasSelection();
-
+    makeTextEditable (qobject_cast< TabPage *>(ui->tabWidget->widget (index))->textEdit());
+}
+/*************************/
+// Also used for a streamed text, which may not be in the current tab.
+void FPwin::makeTextEditable (TextEdit *textEdit)
+{
     textEdit->setReadOnly (false);
     Config config = static_cast<FPsingleton*>(qApp)->getConfig();
     if (!textEdit->hasDarkScheme())
@@ -2967,6 +3341,13 @@ void FPwin::makeEditable()
                                                       "background-color: rgb(%1, %1, %1);}")
                                              .arg (config.getDarkBgColorValue()));
     }
+    connect (textEdit, &QPlainTextEdit::copyAvailable, ui->actionCut, &QAction::setEnabled, Qt::UniqueConnection);
+    connect (textEdit, &QPlainTextEdit::copyAvailable, ui->actionDelete, &QAction::setEnabled, Qt::UniqueConnection);
+
+    /* the actions are updated on switching to another tab */
+    TabPage *tabPage = qobject_cast<TabPage*>(ui->tabWidget->currentWidget());
+    if (tabPage == nullptr || tabPage->textEdit() != textEdit) return;
+    bool textIsSelected = textEdit->textCursor().hasSelection();
     ui->actionEdit->setVisible (false);
 
     ui->actionPaste->setEnabled (true);
@@ -2974,8 +3355,6 @@ void FPwin::makeEditable()
     ui->actionCopy->setEnabled (textIsSelected);
     ui->actionCut->setEnabled (textIsSelected);
     ui->actionDelete->setEnabled (textIsSelected);
-    connect (textEdit, &QPlainTextEdit::copyAvailable, ui->actionCut, &QAction::setEnabled);
-    connect (textEdit, &QPlainTextEdit::copyAvailable, ui->actionDelete, &QAction::setEnabled);
 }
 /*************************/
 void FPwin::undoing()
@@ -3011,9 +3390,12 @@ void FPwin::tabSwitch (int index)
     }
 
     closeWarningBar();
+    /* the result of a regex search is for the previous tab */
+    regexMatcher_->cancel();
 
     TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->widget (index));
     TextEdit *textEdit = tabPage->textEdit();
+    textEdit->setLastVisit (QDateTime::currentMSecsSinceEpoch());
     if (!tabPage->isSearchBarVisible())
         textEdit->setFocus();
     QString fname = textEdit->getFileName();
@@ -3032,7 +3414,14 @@ void FPwin::tabSwitch (int index)
     {
         info.setFile (fname);
         shownName = fname.section ('/', -1);
-        if (!QFile::exists (fname))
+        if (textEdit->isEvicted())
+        { // reload the released document with its encoding and positions
+            encodingToCheck (textEdit->getEncoding());
+            loadText (fname, true, true, textEdit->getSaveCursor(), textEdit->isUneditable(), false);
+        }
+        else if (textEdit->isLazy()) // a restored file is loaded on its first activation
+            loadText (fname, false, false, textEdit->getSaveCursor(), false, false);
+        else if (!QFile::exists (fname))
             showWarningBar ("<center><b><big>" + tr ("The file has been removed.") + "</big></b></center>");
         else if (textEdit->getLastModified() != info.lastModified())
             showWarningBar ("<center><b><big>" + tr ("This file has been modified elsewhere or in another way!") + "</big></b></center>\n"
@@ -3084,7 +3473,7 @@ void FPwin::tabSwitch (int index)
 
     /* handle the spinbox */
     if (ui->spinBox->isVisible())
-        ui->spinBox->setMaximum (textEdit->document()->blockCount());
+        setMax (textEdit->document()->blockCount());
 
     /* handle the statusbar */
     if (ui->statusBar->isVisible())
@@ -3108,6 +3497,7 @@ void FPwin::tabSwitch (int index)
                                   .arg (textEdit->getWordNumber()));
         }
         showCursorPos();
+        showDocMemory();
     }
     if (config.getShowLangSelector() && config.getSyntaxByDefault())
         showLang (textEdit);
@@ -3289,9 +3679,7 @@ void FPwin::jumpTo()
     if (tabPage)
     {
         if (!visibility && ui->tabWidget->count() > 0)
-            ui->spinBox->setMaximum (tabPage->textEdit()
-                                     ->document()
-                                     ->blockCount());
+            setMax (tabPage->textEdit()->document()->blockCount());
     }
     ui->spinBox->setVisible (!visibility);
     ui->label->setVisible (!visibility);
@@ -3307,7 +3695,11 @@ void FPwin::jumpTo()
 /*************************/
 void FPwin::setMax (const int max)
 {
-    ui->spinBox->setMaximum (max);
+    /* the document may have only a part of the file */
+    if (TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget()))
+        ui->spinBox->setMaximum (tabPage->textEdit()->lineCount());
+    else
+        ui->spinBox->setMaximum (max);
 }
 /*************************/
 void FPwin::goTo()
@@ -3319,8 +3711,13 @@ void FPwin::goTo()
     if (TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget()))
     {
         TextEdit *textEdit = tabPage->textEdit();
-        QTextBlock block = textEdit->document()->findBlockByNumber (ui->spinBox->value() - 1);
-        int pos = block.position();
+        int line = ui->spinBox->value() - 1;
+        if (textEdit->getPagedFile())
+        {
+            textEdit->loadLine (line);
+            line -= textEdit->getFirstLine();
+        }
+        int pos = textEdit->linePosition (line);
         QTextCursor start = textEdit->textCursor();
         if (ui->checkBox->isChecked())
             start.setPosition (pos, QTextCursor::KeepAnchor);
@@ -3522,8 +3919,9 @@ void FPwin::docProp()
     updateWordInfo();
 }
 /*************************/
-// Set the status bar text according to the block count.
-void FPwin::statusMsgWithLineCount (const int lines)
+// Set the status bar text according to the line count (the argument is
+// the block count, which may be less when the document has a part of the file).
+void FPwin::statusMsgWithLineCount (const int /*lines*/)
 {
     TextEdit *textEdit = qobject_cast< TabPage *>(ui->tabWidget->currentWidget())->textEdit();
     /* ensure that the signal comes from the active tab if this is about a tab a signal */
@@ -3537,7 +3935,9 @@ void FPwin::statusMsgWithLineCount (const int lines)
     QString syntaxStr;
     if (!textEdit->getProg().isEmpty() && textEdit->getProg() != "help")
         syntaxStr = "&nbsp;&nbsp;&nbsp;&nbsp;<b>" + tr ("Syntax") + QString (":</b> <i>%1</i>").arg (textEdit->getProg());
-    QString lineStr = "&nbsp;&nbsp;&nbsp;&nbsp;<b>" + tr ("Lines") + QString (":</b> <i>%1</i>").arg (lines);
+    /* the document may have only a part of the file */
+    QString lineStr = "&nbsp;&nbsp;&nbsp;&nbsp;<b>" + tr ("Lines")
+                      + QString (":</b> <i>%1</i>").arg (textEdit->lineCount());
     QString selStr = "&nbsp;&nbsp;&nbsp;&nbsp;<b>" + tr ("Sel. Chars")
                      + QString (":</b> <i>%1</i>").arg (textEdit->textCursor().selectedText().size());
     QString wordStr = "&nbsp;&nbsp;&nbsp;&nbsp;<b>" + tr ("Words") + ":</b>";
@@ -4495,6 +4895,96 @@ void FPwin::startAutoSaving (bool start, int interval)
     }
 }
 /*************************/
+// The estimated memory used by the documents of this window (in bytes).
+qint64 FPwin::documentMemory() const
+{
+    qint64 mem = 0;
+    for (int i = 0; i < ui->tabWidget->count(); ++i)
+    {
+        if (TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->widget (i)))
+            mem += tabPage->textEdit()->residentMemory();
+    }
+    return mem;
+}
+/*************************/
+// Returns the inactive tabs that haven't been visited for "idle" ms.
+// The current tab is regarded as being visited now.
+QList<TabPage*> FPwin::idleTabs (qint64 now, qint64 idle)
+{
+    QList<TabPage*> tabs;
+    TabPage *curPage = qobject_cast< TabPage *>(ui->tabWidget->currentWidget());
+    for (int i = 0; i < ui->tabWidget->count(); ++i)
+    {
+        TabPage *tabPage = qobject_cast< TabPage *>(ui->tabWidget->widget (i));
+        if (tabPage == nullptr) continue;
+        TextEdit *textEdit = tabPage->textEdit();
+        if (tabPage == curPage)
+            textEdit->setLastVisit (now);
+        else if (!textEdit->isLazy() && now - textEdit->getLastVisit() >= idle)
+            tabs.append (tabPage);
+    }
+    return tabs;
+}
+/*************************/
+// Releases the document, highlighter and undo stack of an inactive tab,
+// keeping only what is needed for reloading it when it's selected again.
+bool FPwin::evictTab (TabPage *tabPage)
+{
+    if (isLoading() || tabPage == ui->tabWidget->currentWidget())
+        return false;
+    TextEdit *textEdit = tabPage->textEdit();
+    QString fname = textEdit->getFileName();
+    if (fname.isEmpty() || textEdit->isLazy()
+        || textEdit->document()->isModified()
+        /* an uneditable text (with nulls or huge lines) can't be reloaded as it is
+           because enforcing its encoding would skip its checks while loading */
+        || textEdit->isUneditable()
+        || textEdit->getPagedFile() != nullptr) // a page of a huge file doesn't need much memory
+    {
+        return false;
+    }
+    QFileInfo info (fname);
+    if (!info.isFile() || textEdit->getLastModified() != info.lastModified())
+        return false; // the document couldn't be reloaded as it is
+
+    QTextCursor cur = textEdit->textCursor();
+    int scrollbarValue = -1;
+    if (QScrollBar *scrollbar = textEdit->verticalScrollBar())
+    {
+        if (scrollbar->isVisible())
+            scrollbarValue = scrollbar->value();
+    }
+    textEdit->setGreenSel (QList<QTextEdit::ExtraSelection>());
+    syntaxHighlighting (textEdit, false);
+    textEdit->setExtraSelections (QList<QTextEdit::ExtraSelection>());
+    textEdit->setPlainText (QString()); // also clears the undo stack
+    textEdit->setLineIndex (LineIndex());
+    textEdit->setEvicted (cur.position(), cur.anchor(), scrollbarValue);
+    textEdit->setReadOnly (true); // until the document is reloaded
+    textEdit->setWordNumber (-1);
+    return true;
+}
+/*************************/
+// Shows the estimated memory used by the documents of all windows.
+void FPwin::showDocMemory()
+{
+    if (!ui->statusBar->isVisible()) return;
+    QLabel *memLabel = ui->statusBar->findChild<QLabel *>("memLabel");
+    if (memLabel == nullptr)
+    {
+        memLabel = new QLabel();
+        memLabel->setObjectName ("memLabel");
+        memLabel->setIndent (2);
+        memLabel->setTextInteractionFlags (Qt::TextSelectableByMouse);
+        memLabel->setToolTip (tr ("Estimated memory used by the documents of all windows"));
+        ui->statusBar->addPermanentWidget (memLabel);
+    }
+    qint64 mem = static_cast<FPsingleton*>(qApp)->documentMemory();
+    memLabel->setText ("<b>" + tr ("Memory:") + "</b> <i>"
+                       + QString::number (static_cast<double>(mem) / (1024 * 1024), 'f', 1)
+                       + " " + tr ("MiB") + "</i>");
+}
+/*************************/
 void FPwin::autoSave()
 {
     /* since there are important differences between this
@@ -25,8 +25,10 @@
 #include <QElapsedTimer>
 #include "highlighter.h"
 #include "textedit.h"
+#include "pagedfile.h"
 #include "tabpage.h"
 #include "sidepane.h"
+#include "regexsearch.h"
 #include "config.h"
 
 namespace FeatherPad {
@@ -68,10 +70,10 @@ public:
     bool isScriptLang (QString lang);
 
     bool isLoading() {
-        return (loadingProcesses_ > 0);
+        return (loadingProcesses_ > 0 || !streamingTexts_.isEmpty());
     }
     bool isReady() {
-        if (loadingProcesses_ <= 0)
+        if (loadingProcesses_ <= 0 && streamingTexts_.isEmpty())
         {
             closeWarningBar();
             return true;
@@ -91,12 +93,18 @@ public:
 
     void startAutoSaving (bool start, int interval = 1);
 
+    qint64 documentMemory() const;
+    QList<TabPage*> idleTabs (qint64 now, qint64 idle);
+    bool evictTab (TabPage *tabPage);
+    void showDocMemory();
+
 signals:
     void finishedLoading();
 
 public slots:
     void newTabFromName (const QString& fileName, bool saveCursor,
                          bool multiple = false);
+    void newLazyTab (const QString& fileName, bool saveCursor);
     void newTab();
     void statusMsg();
     void statusMsgWithLineCount (const int lines);
@@ -133,6 +141,8 @@ private slots:
     void hlight() const;
     void hlighting (const QRect&, int dy) const;
     void searchFlagChanged();
+    void regexMatched (const QVector<QRegularExpressionMatch>& matches);
+    void regexTimedOut();
     void showHideSearch();
     void showLN (bool checked);
     void toggleSyntaxHighlighting();
@@ -178,8 +188,19 @@ private slots:
     void addText (const QString& text, const QString& fileName, const QString& charset,
                   bool enforceEncod, bool reload, bool saveCursor,
                   bool uneditable, // This doc should be uneditable?
-                  bool multiple); // Multiple files are being loaded?
+                  bool multiple, // Multiple files are being loaded?
+                  const QSharedPointer<PagedFile>& pagedFile, // A huge file is shown page by page?
+                  const LineIndex& lineIndex,
+                  bool uncertainCharset); // Was the encoding guessed?
+    void onLoaded (const QString& text, const QString& fileName, const QString& charset,
+                   bool enforceEncod, bool reload, bool saveCursor,
+                   bool uneditable, bool multiple,
+                   const QSharedPointer<PagedFile>& pagedFile, const LineIndex& lineIndex, bool uncertainCharset);
+    void deliverLoadedTexts();
+    void streamText();
     void onOpeningHugeFiles();
+    void onOpeningPagedFiles();
+    void onUncertainEncoding();
     void onPermissionDenied();
     void onOpeningUneditable();
     void autoSave();
@@ -204,6 +225,14 @@ private:
                    bool saveCursor = false, bool enforceUneditable = false, bool multiple = false);
     bool alreadyOpen (TabPage *tabPage) const;
     void setTitle (const QString& fileName, int tabIndex = -1);
+    /* What is done with the result of a regex search: */
+    enum REGEXTASK {
+      NO_REGEX_TASK,
+      REGEX_FIND,
+      REGEX_REPLACE,
+      REGEX_REPLACE_ALL
+    };
+
     DOCSTATE savePrompt (int tabIndex, bool noToAll);
     bool saveFile (bool keepSyntax);
     void closeEvent (QCloseEvent *event);
@@ -214,24 +243,25 @@ private:
     void changeEvent (QEvent *event);
     bool event (QEvent *event);
     QTextDocument::FindFlags getSearchFlags() const;
+    bool isRegexSearch() const;
     void enableWidgets (bool enable) const;
     void updateShortcuts (bool disable, bool page = true);
     QTextCursor finding (const QString& str, const QTextCursor& start, QTextDocument::FindFlags flags = 0,
                          const int end = 0) const;
+    QTextCursor findInPagedFile (TextEdit *textEdit, const QString& str, bool forward) const;
+    void startRegexSearch (TextEdit *textEdit, const QString& pattern, RegexMatcher::Mode mode, REGEXTASK task);
+    void showRegexMessage (const QString& message, REGEXTASK task);
     void setProgLang (TextEdit *textEdit);
     void syntaxHighlighting (TextEdit *textEdit, bool highlight = true, const QString& lang = QString());
     void encodingToCheck (const QString& encoding);
     const QString checkToEncoding() const;
     void applyConfigOnStarting();
-    bool matchLeftParenthesis (QTextBlock currentBlock, int index, int numRightParentheses);
-    bool matchRightParenthesis (QTextBlock currentBlock, int index, int numLeftParentheses);
-    bool matchLeftBrace (QTextBlock currentBlock, int index, int numRightBraces);
-    bool matchRightBrace (QTextBlock currentBlock, int index, int numLeftBraces);
-    bool matchLeftBracket (QTextBlock currentBlock, int index, int numRightBrackets);
-    bool matchRightBracket (QTextBlock currentBlock, int index, int numLeftBrackets);
     void createSelection (int pos);
     void formatTextRect (QRect rect) const;
     void removeGreenSel();
+    void replaceFound (TextEdit *textEdit, const QTextCursor& found, const QString& replacement);
+    void replaceAllMatches (TextEdit *textEdit, const QVector<int>& matches, const QVector<int>& lengths,
+                            const QStringList& replacements);
     void waitToMakeBusy();
     void unbusy();
     void displayMessage (bool error);
@@ -242,18 +272,71 @@ private:
     void toggleSidePane();
     void showLang (TextEdit *textEdit);
     void handleNormalAsUrl (TextEdit *textEdit);
+    void makeTextEditable (TextEdit *textEdit);
+    void finishStreaming (TextEdit *textEdit, int pos, int anchor,
+                          int scrollbarValue, bool readOnly, bool editable);
+    void showStreamingProgress();
+    void startLoadings();
+    void showLoadingProgress();
 
     QActionGroup *aGroup_;
     QString lastFile_; // The last opened or saved file (for file dialogs).
     QString txtReplace_; // The replacing text.
     int rightClicked_; // The index/row of the right-clicked tab/item.
     int loadingProcesses_; // The number of loading processes (used to prevent early closing).
+    /* Files are loaded by a limited number of threads but their
+       texts are added in the order of their loading requests: */
+    struct fileLoading {
+      QString fileName;
+      QString charset; // The enforced encoding (if any).
+      bool reload;
+      bool saveCursor;
+      bool enforceUneditable;
+      bool multiple;
+      int seq; // The place in the order of texts (-1 if the text should be added at once).
+    };
+    struct loadedText {
+      QString text;
+      QString fileName;
+      QString charset;
+      bool enforceEncod;
+      bool reload;
+      bool saveCursor;
+      bool uneditable;
+      bool multiple;
+      QSharedPointer<PagedFile> pagedFile;
+      LineIndex lineIndex;
+      bool uncertainCharset;
+    };
+    QList<fileLoading> pendingLoadings_; // Not started yet.
+    QHash<QObject*, int> runningLoadings_; // Loading threads and the sequence numbers of their texts.
+    QMap<int, loadedText> loadedTexts_; // Loaded but waiting for the previous texts.
+    int nextSeq_, deliverSeq_; // The sequence numbers of the next requested and added texts.
+    int requestedFiles_, openedFiles_; // For showing the progress of opening multiple files.
+    bool currentTabClaimed_; // Whether a requested text will be opened in the current tab.
+    /* Huge texts are put into their documents chunk by chunk: */
+    struct streamingText {
+      QPointer<TextEdit> textEdit;
+      QString text; // The whole text.
+      int pos; // The position of the next chunk in the text.
+      int cursorPos, cursorAnchor; // The cursor to be restored at the end (-1 if none).
+      int scrollbarValue; // The scrollbar value to be restored at the end (-1 if none).
+      bool readOnly; // Should the document be read-only at the end?
+      bool makeEditable; // Should the document be made editable at the end?
+    };
+    QList<streamingText> streamingTexts_;
+    QTimer *streamer_;
     QPointer<QThread> busyThread_; // Used to wait one second for making the cursor busy.
     ICONMODE iconMode_; // Used only internally.
     QMetaObject::Connection lambdaConnection_; // Captures a lambda connection to disconnect it later.
     SidePane *sidePane_;
     QHash<QListWidgetItem*, TabPage*> sideItems_; // For fast tab switching.
     QHash<QString, QAction*> langs; // All programming languages (to be enforced by the user).
+    // Regex search (one at a time):
+    RegexMatcher *regexMatcher_;
+    REGEXTASK regexTask_;
+    QPointer<TextEdit> regexTextEdit_; // The searched document.
+    int regexRevision_; // The revision of the searched document.
     // Auto-saving:
     QTimer *autoSaver_;
     QElapsedTimer autoSaverPause_;
@@ -21,10 +21,23 @@
 
 namespace FeatherPad {
 
+static const QRegularExpression htmlTagStartExp = precompiled ("<(?!\\!)/{0,1}[A-Za-z0-9_\\-]+");
+static const QRegularExpression htmlTagEndExp = precompiled (">");
+static const QRegularExpression styleStartExp = precompiled ("<(style|STYLE)$|<(style|STYLE)\\s+[^>]*");
+static const QRegularExpression htmlAttributeExp = precompiled ("[A-Za-z0-9_\\-]+(?=\\s*\\=)");
+static const QRegularExpression styleTagStartExp = precompiled ("<(style|STYLE)>|<(style|STYLE)\\s+[^>]*>");
+static const QRegularExpression styleTagEndExp = precompiled ("</(style|STYLE)\\s*>");
+static const QRegularExpression cCommentStartExp = precompiled ("/\\*");
+static const QRegularExpression cCommentEndExp = precompiled ("\\*/");
+static const QRegularExpression htmlCommentStartExp = precompiled ("<!--");
+static const QRegularExpression htmlCommentEndExp = precompiled ("-->");
+static const QRegularExpression scriptTagStartExp = precompiled ("<(script|SCRIPT)\\s+(language|LANGUAGE)\\s*\\=\\s*\"\\s*JavaScript\\s*\"[A-Za-z0-9_\\.\"\\s\\=]*>");
+static const QRegularExpression scriptTagEndExp = precompiled ("</(script|SCRIPT)\\s*>");
+
 // This should be called before "htmlCSSHighlighter()" and "htmlJavascript()".
 void Highlighter::htmlBrackets (const QString &text, const int start)
 {
-    if (progLan != "html") return;
+    if (langId != htmlLanguage) return;
 
     /*****************************
      * (Multiline) HTML Brackets *
@@ -33,10 +46,10 @@ void Highlighter::htmlBrackets (const QString &text, const int start)
     int braIndex = start;
     int indx = 0;
     QRegularExpressionMatch startMatch;
-    QRegularExpression braStartExp ("<(?!\\!)/{0,1}[A-Za-z0-9_\\-]+");
+    QRegularExpression braStartExp = htmlTagStartExp;
     QRegularExpressionMatch endMatch;
-    QRegularExpression braEndExp (">");
-    QRegularExpression styleExp ("<(style|STYLE)$|<(style|STYLE)\\s+[^>]*");
+    QRegularExpression braEndExp = htmlTagEndExp;
+    QRegularExpression styleExp = styleStartExp;
     bool isStyle (false);
     QTextCharFormat htmlBraFormat;
     htmlBraFormat.setFontWeight (QFont::Bold);
@@ -67,7 +80,7 @@ void Highlighter::htmlBrackets (const QString &text, const int start)
     }
 
     int bn = currentBlock().blockNumber();
-    bool mainFormatting (bn >= startCursor.blockNumber() && bn <= endCursor.blockNumber());
+    bool mainFormatting (isMainFormatting (bn));
     bool hugeLine (text.length() > 50000);
     int firstBraIndex = braIndex; // to check progress in the following loop
     while (braIndex >= 0)
@@ -127,7 +140,7 @@ void Highlighter::htmlBrackets (const QString &text, const int start)
 
         int quoteIndex = braIndex;
         QRegularExpressionMatch quoteMatch;
-        QRegularExpression quoteExpression ("\"|\'");
+        QRegularExpression quoteExpression = mixedQuoteExp;
         int quote = doubleQuoteState;
 
         /* find the start quote */
@@ -151,7 +164,7 @@ void Highlighter::htmlBrackets (const QString &text, const int start)
                 }
                 else
                 {
-                    quoteExpression.setPattern ("\'");
+                    quoteExpression = singleQuoteExp;
                     quote = currentBlockState() == htmlStyleState ? htmlStyleSingleQuoteState
                                                                   : singleQuoteState;
                 }
@@ -165,7 +178,7 @@ void Highlighter::htmlBrackets (const QString &text, const int start)
             if (quote == doubleQuoteState || quote == htmlStyleDoubleQuoteState)
                 quoteExpression = quoteMark;
             else
-                quoteExpression.setPattern ("\'");
+                quoteExpression = singleQuoteExp;
         }
 
         while (quoteIndex >= braIndex && quoteIndex <= endLimit)
@@ -183,7 +196,7 @@ void Highlighter::htmlBrackets (const QString &text, const int start)
                 }
                 else
                 {
-                    quoteExpression.setPattern ("\'");
+                    quoteExpression = singleQuoteExp;
                     quote = currentBlockState() == htmlStyleState ? htmlStyleSingleQuoteState
                                                                   : singleQuoteState;
                 }
@@ -229,7 +242,7 @@ void Highlighter::htmlBrackets (const QString &text, const int start)
                                                                              : altQuoteFormat);
 
             /* the next quote may be different */
-            quoteExpression.setPattern ("\"|\'");
+            quoteExpression = mixedQuoteExp;
             quoteIndex = text.indexOf (quoteExpression, quoteIndex + quoteLength);
         }
 
@@ -243,7 +256,7 @@ void Highlighter::htmlBrackets (const QString &text, const int start)
             htmlAttributeFormat.setFontItalic (true);
             htmlAttributeFormat.setForeground (Brown);
             QRegularExpressionMatch attMatch;
-            QRegularExpression attExp ("[A-Za-z0-9_\\-]+(?=\\s*\\=)");
+            QRegularExpression attExp = htmlAttributeExp;
             int attIndex = text.indexOf (attExp, braIndex, &attMatch);
             QTextCharFormat fi = format (attIndex);
             while (fi == quoteFormat || fi == altQuoteFormat || fi == urlInsideQuoteFormat)
@@ -314,21 +327,22 @@ void Highlighter::htmlBrackets (const QString &text, const int start)
 /*************************/
 void Highlighter::htmlCSSHighlighter (const QString &text, const int start)
 {
-    if (progLan != "html") return;
+    if (langId != htmlLanguage) return;
 
     int cssIndex = start;
 
     QRegularExpressionMatch startMatch;
-    QRegularExpression cssStartExp ("<(style|STYLE)>|<(style|STYLE)\\s+[^>]*>");
+    QRegularExpression cssStartExp = styleTagStartExp;
     QRegularExpressionMatch endMatch;
-    QRegularExpression cssEndExp ("</(style|STYLE)\\s*>");
+    QRegularExpression cssEndExp = styleTagEndExp;
     QRegularExpressionMatch braMatch;
-    QRegularExpression braEndExp (">");
+    QRegularExpression braEndExp = htmlTagEndExp;
 
     /* switch to css temporarily */
-    commentStartExpression.setPattern ("/\\*");
-    commentEndExpression.setPattern ("\\*/");
+    commentStartExpression = cCommentStartExp;
+    commentEndExpression = cCommentEndExp;
     progLan = "css";
+    langId = cssLanguage;
 
     bool wasCSS (false);
     int prevState = previousBlockState();
@@ -372,7 +386,7 @@ void Highlighter::htmlCSSHighlighter (const QString &text, const int start)
     }
     TextBlockData *curData = static_cast<TextBlockData *>(currentBlock().userData());
     int bn = currentBlock().blockNumber();
-    bool mainFormatting (bn >= startCursor.blockNumber() && bn <= endCursor.blockNumber());
+    bool mainFormatting (isMainFormatting (bn));
     while (cssIndex >= 0)
     {
         /* single-line style bracket (<style ...>) */
@@ -447,8 +461,10 @@ void Highlighter::htmlCSSHighlighter (const QString &text, const int start)
             setFormat (cssEndIndex, text.length() - cssEndIndex, neutralFormat);
             setCurrentBlockState (0);
             progLan = "html";
+            langId = htmlLanguage;
             htmlBrackets (text, cssEndIndex);
             progLan = "css";
+            langId = cssLanguage;
         }
 
         cssIndex = text.indexOf (cssStartExp, cssIndex + len, &startMatch);
@@ -465,25 +481,27 @@ void Highlighter::htmlCSSHighlighter (const QString &text, const int start)
 
     /* revert to html */
     progLan = "html";
-    commentStartExpression.setPattern ("<!--");
-    commentEndExpression.setPattern ("-->");
+    langId = htmlLanguage;
+    commentStartExpression = htmlCommentStartExp;
+    commentEndExpression = htmlCommentEndExp;
 }
 /*************************/
 void Highlighter::htmlJavascript (const QString &text)
 {
-    if (progLan != "html") return;
+    if (langId != htmlLanguage) return;
 
     int javaIndex = 0;
 
     QRegularExpressionMatch startMatch;
-    QRegularExpression javaStartExp ("<(script|SCRIPT)\\s+(language|LANGUAGE)\\s*\\=\\s*\"\\s*JavaScript\\s*\"[A-Za-z0-9_\\.\"\\s\\=]*>");
+    QRegularExpression javaStartExp = scriptTagStartExp;
     QRegularExpressionMatch endMatch;
-    QRegularExpression javaEndExp ("</(script|SCRIPT)\\s*>");
+    QRegularExpression javaEndExp = scriptTagEndExp;
 
     /* switch to javascript temporarily */
-    commentStartExpression.setPattern ("/\\*");
-    commentEndExpression.setPattern ("\\*/");
+    commentStartExpression = cCommentStartExp;
+    commentEndExpression = cCommentEndExp;
     progLan = "javascript";
+    langId = javascriptLanguage;
 
     bool wasJavascript (false);
     QTextBlock prevBlock = currentBlock().previous();
@@ -509,7 +527,7 @@ void Highlighter::htmlJavascript (const QString &text)
     int matched = 0;
     TextBlockData *curData = static_cast<TextBlockData *>(currentBlock().userData());
     int bn = currentBlock().blockNumber();
-    bool mainFormatting (bn >= startCursor.blockNumber() && bn <= endCursor.blockNumber());
+    bool mainFormatting (isMainFormatting (bn));
     while (javaIndex >= 0)
     {
         if (!wasJavascript || javaIndex > 0)
@@ -610,9 +628,11 @@ void Highlighter::htmlJavascript (const QString &text)
             setFormat (javaEndIndex, text.length() - javaEndIndex, neutralFormat);
             setCurrentBlockState (0);
             progLan = "html";
+            langId = htmlLanguage;
             htmlBrackets (text, javaEndIndex);
             htmlCSSHighlighter (text, javaEndIndex);
             progLan = "javascript";
+            langId = javascriptLanguage;
         }
 
         javaIndex = text.indexOf (javaStartExp, javaIndex + len, &startMatch);
@@ -628,8 +648,9 @@ void Highlighter::htmlJavascript (const QString &text)
 
     /* revert to html */
     progLan = "html";
-    commentStartExpression.setPattern ("<!--");
-    commentEndExpression.setPattern ("-->");
+    langId = htmlLanguage;
+    commentStartExpression = htmlCommentStartExp;
+    commentEndExpression = htmlCommentEndExp;
 }
 
 }
@@ -21,11 +21,15 @@
 
 namespace FeatherPad {
 
+static const QRegularExpression nonSpaceExp = precompiled ("[^\\s]+");
+static const QRegularExpression slashExp = precompiled ("/");
+static const QRegularExpression jsRegexEndExp = precompiled ("/[A-Za-z0-9_]*");
+
 // This is only for the starting "/".
 bool Highlighter::isEscapedJSRegex (const QString &text, const int pos)
 {
     if (pos < 0) return false;
-    if (progLan != "javascript") return false;
+    if (langId != javascriptLanguage) return false;
 
     /* escape "<.../>", "</...>" and the single-line comment sign ("//") */
     if ((text.length() > pos + 1 && (text.at (pos + 1) == '>'
@@ -49,7 +53,7 @@ bool Highlighter::isEscapedJSRegex (const QString &text, const int pos)
         QTextBlock prev = currentBlock().previous();
         if (!prev.isValid()) return false;
         QString txt = prev.text();
-        QRegularExpression nonSpace ("[^\\s]+");
+        QRegularExpression nonSpace = nonSpaceExp;
         while (txt.indexOf (nonSpace, 0) == -1)
         {
             prev.setUserState (updateState); // update the next line if this one changes
@@ -73,7 +77,7 @@ bool Highlighter::isEscapedJSRegex (const QString &text, const int pos)
                 || ch == ')' || ch == ']') // as with Kate
             { // a regex isn't escaped if it follows a JavaScript keyword
                 if (keys.pattern().isEmpty())
-                    keys.setPattern (keywords (progLan).join ('|'));
+                    keys = precompiled (keywords (progLan).join ('|'));
                 int len = qMin (12, last + 1);
                 QString str = txt.mid (last - len + 1, len);
                 int j;
@@ -90,7 +94,7 @@ bool Highlighter::isEscapedJSRegex (const QString &text, const int pos)
                                             || ch == ')' || ch == ']')) // as with Kate
         { // a regex isn't escaped if it follows a JavaScript keyword
             if (keys.pattern().isEmpty())
-                keys.setPattern (keywords (progLan).join ('|'));
+                keys = precompiled (keywords (progLan).join ('|'));
             int len = qMin (12, i + 1);
             QString str = text.mid (i - len + 1, len);
             int j;
@@ -107,9 +111,9 @@ bool Highlighter::isEscapedJSRegex (const QString &text, const int pos)
 bool Highlighter::isInsideJSRegex (const QString &text, const int index)
 {
     if (index < 0) return false;
-    if (progLan != "javascript") return false;
+    if (langId != javascriptLanguage) return false;
 
-    QRegularExpression exp ("/");
+    QRegularExpression exp = slashExp;
     bool res = false;
     int pos = -1;
     int N;
@@ -155,13 +159,13 @@ bool Highlighter::isInsideJSRegex (const QString &text, const int index)
 void Highlighter::multiLineJSRegex (const QString &text, const int index)
 {
     if (index < 0) return;
-    if (progLan != "javascript") return;
+    if (langId != javascriptLanguage) return;
 
     int startIndex = index;
     QRegularExpressionMatch startMatch;
-    QRegularExpression startExp ("/");
+    QRegularExpression startExp = slashExp;
     QRegularExpressionMatch endMatch;
-    QRegularExpression endExp ("/[A-Za-z0-9_]*");
+    QRegularExpression endExp = jsRegexEndExp;
     QTextCharFormat fi;
 
     int prevState = previousBlockState();
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#include "highlighter.h"
+
+namespace FeatherPad {
+
+/* The lexical structure of languages, as the stages of highlightBlock() that
+   should be run for them and the delimiters of their multiline comments.
+   A language that isn't listed here has single-line comments and quotes. */
+static const struct LexerRow
+{
+    Language lang;
+    int stages;
+    const char *commentStart;
+    const char *commentEnd;
+} lexerRows[] =
+{
+    {cLanguage, Highlighter::singleLineCommentStage | Highlighter::quoteStage | Highlighter::multiLineCommentStage, "/\\*", "\\*/"},
+    {cppLanguage, Highlighter::singleLineCommentStage | Highlighter::quoteStage | Highlighter::multiLineCommentStage, "/\\*", "\\*/"},
+    {javascriptLanguage, Highlighter::singleLineCommentStage | Highlighter::quoteStage | Highlighter::multiLineCommentStage, "/\\*", "\\*/"},
+    {qmlLanguage, Highlighter::singleLineCommentStage | Highlighter::quoteStage | Highlighter::multiLineCommentStage, "/\\*", "\\*/"},
+    {phpLanguage, Highlighter::singleLineCommentStage | Highlighter::quoteStage | Highlighter::multiLineCommentStage, "/\\*", "\\*/"},
+    {cssLanguage, Highlighter::singleLineCommentStage | Highlighter::quoteStage | Highlighter::multiLineCommentStage, "/\\*", "\\*/"},
+    {scssLanguage, Highlighter::singleLineCommentStage | Highlighter::quoteStage | Highlighter::multiLineCommentStage, "/\\*", "\\*/"},
+    {luaLanguage, Highlighter::singleLineCommentStage | Highlighter::quoteStage | Highlighter::multiLineCommentStage, "\\[\\[|--\\[\\[", "\\]\\]"},
+    /* python comments are formatted by pythonMLComment() */
+    {pythonLanguage, Highlighter::singleLineCommentStage | Highlighter::quoteStage, "\"\"\"|\'\'\'", "\"\"\"|\'\'\'"},
+    {perlLanguage, Highlighter::hereDocStage | Highlighter::singleLineCommentStage | Highlighter::quoteStage | Highlighter::multiLineCommentStage, "^=[A-Za-z0-9_]+($|\\s+)", "^=cut.*"},
+    {shLanguage, Highlighter::hereDocStage | Highlighter::singleLineCommentStage | Highlighter::shQuoteStage | Highlighter::escapedBracketStage, "", ""},
+    {makefileLanguage, Highlighter::hereDocStage | Highlighter::singleLineCommentStage | Highlighter::quoteStage, "", ""},
+    {cmakeLanguage, Highlighter::hereDocStage | Highlighter::singleLineCommentStage | Highlighter::quoteStage, "", ""},
+    {rubyLanguage, Highlighter::hereDocStage | Highlighter::singleLineCommentStage | Highlighter::quoteStage, "", ""},
+    {xmlLanguage, Highlighter::singleLineCommentStage | Highlighter::xmlQuoteStage | Highlighter::multiLineCommentStage, "<!--", "-->"},
+    {htmlLanguage, Highlighter::multiLineCommentStage | Highlighter::htmlStage, "<!--", "-->"},
+    {markdownLanguage, Highlighter::singleLineCommentStage | Highlighter::quoteStage | Highlighter::multiLineCommentStage | Highlighter::markdownStage, "<!--", "-->"},
+    {debLanguage, Highlighter::debControlStage | Highlighter::singleLineCommentStage, "", ""},
+    {diffLanguage, Highlighter::singleLineCommentStage, "", ""},
+    {logLanguage, Highlighter::singleLineCommentStage, "", ""},
+    {desktopLanguage, Highlighter::singleLineCommentStage, "", ""},
+    {configLanguage, Highlighter::singleLineCommentStage, "", ""},
+    {themeLanguage, Highlighter::singleLineCommentStage, "", ""},
+    {changelogLanguage, Highlighter::singleLineCommentStage, "", ""},
+    {urlLanguage, Highlighter::singleLineCommentStage, "", ""},
+    {srtLanguage, Highlighter::singleLineCommentStage, "", ""},
+    {m3uLanguage, Highlighter::singleLineCommentStage, "", ""}
+};
+
+// The table is compiled once, when the first highlighter is created.
+Highlighter::Lexer Highlighter::lexer (Language lang)
+{
+    static QVector<Lexer> lexers;
+    if (lexers.isEmpty())
+    {
+        Lexer defaultLexer;
+        defaultLexer.stages = singleLineCommentStage | quoteStage;
+        lexers.fill (defaultLexer, languageCount);
+        for (const LexerRow &row : lexerRows)
+        {
+            Lexer &l = lexers[row.lang];
+            l.stages = row.stages;
+            if (row.commentStart[0] != '\0')
+            {
+                l.commentStart = precompiled (QString::fromLatin1 (row.commentStart));
+                l.commentEnd = precompiled (QString::fromLatin1 (row.commentEnd));
+            }
+        }
+    }
+    return lexers.at (lang);
+}
+
+}
@@ -151,18 +151,18 @@ QStringList Highlighter::keywords (const QString &lang)
 QStringList Highlighter::types()
 {
     QStringList typePatterns;
-    if (progLan == "c" || progLan == "cpp")
+    if (langId == cLanguage || langId == cppLanguage)
     {
         typePatterns << "\\b(bool|char|double|float)(?!(\\.|-|@|#|\\$))\\b"
                      << "\\b(gchar|gint|guint|guint8|gboolean)(?!(\\.|-|@|#|\\$))\\b"
                      << "\\b(int|long|short)(?!(\\.|-|@|#|\\$))\\b"
                      << "\\b(unsigned|uint32|uint32_t|uint8_t)(?!(\\.|-|@|#|\\$))\\b"
                      << "\\b(void|wchar_t)(?!(\\.|-|@|#|\\$))\\b";
-        if (progLan == "cpp")
+        if (langId == cppLanguage)
             typePatterns << "\\b(qreal|qint8|quint8|qint16|quint16|qint32|quint32|qint64|quint64|qlonglong|qulonglong|qptrdiff|quintptr)(?!(\\.|-|@|#|\\$))\\b"
                          << "\\b(uchar|uint|ulong|ushort)(?!(\\.|-|@|#|\\$))\\b";
     }
-    else if (progLan == "qml")
+    else if (langId == qmlLanguage)
     {
         typePatterns << "\\b(bool|double|enumeration|int|list|real|string|url|var)(?!(@|#|\\$))\\b"
                      << "\\b(color|date|font|matrix4x4|point|quaternion|rect|size|vector2d|vector3d|vector4d)(?!(@|#|\\$))\\b";
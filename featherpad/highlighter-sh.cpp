@@ -18,17 +18,20 @@
  */
 
 #include "highlighter.h"
+#include <algorithm>
 
 namespace FeatherPad {
 
+static const QRegularExpression cmdStartExp = precompiled ("\\$\\(");
+
 // multi/single-line quote highlighting for bash.
 void Highlighter::SH_MultiLineQuote (const QString &text)
 {
-    static const QRegularExpression urlPattern ("[A-Za-z0-9_]+://[A-Za-z0-9_.+/\\?\\=~&%#\\-:]+|[A-Za-z0-9_.\\-]+@[A-Za-z0-9_\\-]+\\.[A-Za-z0-9.]+");
+    static const QRegularExpression urlPattern = precompiled ("[A-Za-z0-9_]+://[A-Za-z0-9_.+/\\?\\=~&%#\\-:]+|[A-Za-z0-9_.\\-]+@[A-Za-z0-9_\\-]+\\.[A-Za-z0-9.]+");
 
     int index = 0;
     QRegularExpressionMatch quoteMatch;
-    QRegularExpression quoteExpression ("\"|\'");
+    QRegularExpression quoteExpression = mixedQuoteExp;
     int initialState = currentBlockState();
     int prevState = previousBlockState();
 
@@ -50,7 +53,7 @@ void Highlighter::SH_MultiLineQuote (const QString &text)
     int hereDocDelimPos = -1;
     if (!curData->labelInfo().isEmpty()) // the label is delimStr
     {
-        QRegularExpression delim ("<<(?:\\s*)(\\\\{0,1}[A-Za-z0-9_]+)|<<(?:\\s*)(\'[A-Za-z0-9_]+\')|<<(?:\\s*)(\"[A-Za-z0-9_]+\")");
+        QRegularExpression delim = shHereDocExp;
         hereDocDelimPos = text.indexOf (delim);
     }
 
@@ -73,7 +76,7 @@ void Highlighter::SH_MultiLineQuote (const QString &text)
             if (index == text.indexOf (quoteMark, index))
                 quoteExpression = quoteMark;
             else
-                quoteExpression.setPattern ("\'");
+                quoteExpression = singleQuoteExp;
         }
     }
     else // but if we're inside a quotation
@@ -83,7 +86,7 @@ void Highlighter::SH_MultiLineQuote (const QString &text)
         if (wasDQuoted)
             quoteExpression = quoteMark;
         else
-            quoteExpression.setPattern ("\'");
+            quoteExpression = singleQuoteExp;
     }
 
     while (index >= 0)
@@ -96,7 +99,7 @@ void Highlighter::SH_MultiLineQuote (const QString &text)
             if (index == text.indexOf (quoteMark, index))
                 quoteExpression = quoteMark;
             else
-                quoteExpression.setPattern ("\'");
+                quoteExpression = singleQuoteExp;
         }
 
         int endIndex;
@@ -150,7 +153,7 @@ void Highlighter::SH_MultiLineQuote (const QString &text)
         }
 
         /* the next quote may be different */
-        quoteExpression.setPattern ("\"|\'");
+        quoteExpression = mixedQuoteExp;
         index = text.indexOf (quoteExpression, index + quoteLength);
 
         /* skip escaped start quotes and all comments */
@@ -176,15 +179,36 @@ bool Highlighter::SH_SkipQuote (const QString &text, const int pos, bool isStart
             || fi == urlInsideQuoteFormat);
 }
 /*************************/
+// The open quotes of nests are kept in sorted vectors, like in block data. Since
+// the vectors may be shared with block data, they're changed only when needed.
+static inline bool hasQuote (const QVector<int> &quotes, int nest)
+{
+    return std::binary_search (quotes.constBegin(), quotes.constEnd(), nest);
+}
+
+static inline void insertQuote (QVector<int> &quotes, int nest)
+{
+    QVector<int>::const_iterator it = std::lower_bound (quotes.constBegin(), quotes.constEnd(), nest);
+    if (it == quotes.constEnd() || *it != nest)
+        quotes.insert (static_cast<int>(it - quotes.constBegin()), nest);
+}
+
+static inline void removeQuote (QVector<int> &quotes, int nest)
+{
+    QVector<int>::const_iterator it = std::lower_bound (quotes.constBegin(), quotes.constEnd(), nest);
+    if (it != quotes.constEnd() && *it == nest)
+        quotes.remove (static_cast<int>(it - quotes.constBegin()));
+}
+/*************************/
 // Formats the text inside a command substitution variable character by character,
 // considering single and double quotes, code block start and end, and comments.
 int Highlighter::formatInsideCommand (const QString &text,
-                                      const int minOpenNests, int &nests, QSet<int> &quotes,
+                                      const int minOpenNests, int &nests, QVector<int> &quotes,
                                       const bool isHereDocStart, const int index)
 {
     int p = 0;
     int indx = index;
-    bool doubleQuoted (quotes.contains (nests));
+    bool doubleQuoted (hasQuote (quotes, nests));
     bool comment (false);
     int initialOpenNests = nests;
     while (nests > minOpenNests && indx < text.length())
@@ -212,7 +236,6 @@ int Highlighter::formatInsideCommand (const QString &text,
                     ++ indx;
                 else
                 {
-                    QRegularExpression singleQuoteExp ("\'");
                     int end = text.indexOf (singleQuoteExp, indx + 1);
                     while (isEscapedQuote (text, end, false))
                         end = text.indexOf (singleQuoteExp, end + 1);
@@ -298,10 +321,10 @@ int Highlighter::formatInsideCommand (const QString &text,
                     if (p < 0)
                     {
                         setFormat (indx, 1, neutralFormat); // never commented
-                        quotes.remove (initialOpenNests);
+                        removeQuote (quotes, initialOpenNests);
                         -- nests;
                         initialOpenNests = nests;
-                        doubleQuoted = quotes.contains (nests);
+                        doubleQuoted = hasQuote (quotes, nests);
                         p = 0;
                     }
                     else if (comment)
@@ -364,26 +387,26 @@ int Highlighter::formatInsideCommand (const QString &text,
         { // FIXME: This state is redundant. remove it later!
             setCurrentBlockState (SH_DoubleQuoteState);
         }
-        quotes.insert (initialOpenNests);
+        insertQuote (quotes, initialOpenNests);
     }
     else
-        quotes.remove (initialOpenNests);
+        removeQuote (quotes, initialOpenNests);
     return indx;
 }
 /*************************/
 // This function highlights command substitution variables $(...).
 bool Highlighter::SH_CmndSubstVar (const QString &text,
                                    TextBlockData *currentBlockData,
-                                   int oldOpenNests, const QSet<int> &oldOpenQuotes)
+                                   int oldOpenNests, const QVector<int> &oldOpenQuotes)
 {
-    if (progLan != "sh" || !currentBlockData) return false;
+    if (langId != shLanguage || !currentBlockData) return false;
 
     int prevState = previousBlockState();
     int curState = currentBlockState();
     bool isHereDocStart = (curState < -1 || curState >= endState);
 
     int N = 0;
-    QSet<int> Q;
+    QVector<int> Q;
     QTextBlock prevBlock = currentBlock().previous();
     /* get the data about open nests and their (double) quotes */
     if (prevBlock.isValid())
@@ -405,7 +428,7 @@ bool Highlighter::SH_CmndSubstVar (const QString &text,
         if (prevState == SH_SingleQuoteState
             || prevState == SH_MixedSingleQuoteState)
         {
-            QRegularExpression quoteExpression ("\'");
+            QRegularExpression quoteExpression = singleQuoteExp;
             end = text.indexOf (quoteExpression);
             while (isEscapedQuote (text, end, false))
                 end = text.indexOf (quoteExpression, end + 1);
@@ -437,7 +460,7 @@ bool Highlighter::SH_CmndSubstVar (const QString &text,
     {
         if (N == 0)
         { // search for the first code block (after the previous one is closed)
-            int start = text.indexOf (QRegularExpression ("\\$\\("), indx);
+            int start = text.indexOf (cmdStartExp, indx);
             if (start == -1 || format (start) == commentFormat)
                 goto FINISH;
             else
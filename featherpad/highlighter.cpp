@@ -19,50 +19,248 @@
 
 #include "highlighter.h"
 #include <QTextDocument>
+#include <QThread>
+#include <algorithm>
 
 Q_DECLARE_METATYPE(QTextBlock)
 
 namespace FeatherPad {
 
 /* NOTE: It is supposed that a URL does not end with punctuation marks. */
-static const QRegularExpression urlPattern ("[A-Za-z0-9_]+://((?!&quot;|&gt;|&lt;)[A-Za-z0-9_.+/\\?\\=~&%#\\-:\\(\\)\\[\\]])+(?<!\\.|\\?|:)|[A-Za-z0-9_.\\-]+@[A-Za-z0-9_\\-]+\\.[A-Za-z0-9.]+(?<!\\.)");
-static const QRegularExpression notePattern ("\\b(NOTE|TODO|FIXME|WARNING)\\b");
-
-TextBlockData::~TextBlockData()
+static const QRegularExpression urlPattern = precompiled ("[A-Za-z0-9_]+://((?!&quot;|&gt;|&lt;)[A-Za-z0-9_.+/\\?\\=~&%#\\-:\\(\\)\\[\\]])+(?<!\\.|\\?|:)|[A-Za-z0-9_.\\-]+@[A-Za-z0-9_\\-]+\\.[A-Za-z0-9.]+(?<!\\.)");
+static const QRegularExpression notePattern = precompiled ("\\b(NOTE|TODO|FIXME|WARNING)\\b");
+
+/* The expressions of highlightBlock() and its helpers, which should be compiled
+   only once and not for each block (see "regexps.h"). */
+const QRegularExpression Highlighter::singleQuoteExp = precompiled ("\'");
+const QRegularExpression Highlighter::mixedQuoteExp = precompiled ("\"|\'");
+const QRegularExpression Highlighter::shHereDocExp = precompiled ("<<(?:\\s*)(\\\\{0,1}[A-Za-z0-9_]+)|<<(?:\\s*)(\'[A-Za-z0-9_]+\')|<<(?:\\s*)(\"[A-Za-z0-9_]+\")");
+static const QRegularExpression hereDocStartExp = precompiled ("<<\\s*");
+static const QRegularExpression hereDocQuoteExp = precompiled ("<<(?:\\s*)(\'[A-Za-z0-9_]+)|<<(?:\\s*)(\"[A-Za-z0-9_]+)");
+static const QRegularExpression cmdSubstitutionExp = precompiled ("[^\"]*\\$\\(");
+static const QRegularExpression dollarExp = precompiled ("\\$");
+static const QRegularExpression backslashExp = precompiled ("\\\\");
+static const QRegularExpression tripleDoubleQuoteExp = precompiled ("\"\"\"");
+static const QRegularExpression tripleSingleQuoteExp = precompiled ("\'\'\'");
+static const QRegularExpression caretExp = precompiled ("\\^");
+static const QRegularExpression tripleQuoteExp = precompiled ("\"\"\"|\'\'\'");
+static const QRegularExpression braceStartExp = precompiled ("\\{");
+static const QRegularExpression braceEndExp = precompiled ("\\}");
+static const QRegularExpression cssNumberExp = precompiled ("(-|\\+){0,1}\\b\\d*\\.{0,1}\\d+");
+static const QRegularExpression cssSelectorExp = precompiled ("[^\\{\\}\\s]+");
+static const QRegularExpression cssAttributeExp = precompiled ("[A-Za-z0-9_\\-]+(?=\\s*:.*;*)");
+static const QRegularExpression colonExp = precompiled (":");
+static const QRegularExpression cssValueEndExp = precompiled (";|\\}");
+static const QRegularExpression colorValueExp = precompiled ("#([A-Fa-f0-9]{3}){0,2}(?![A-Za-z0-9_]+)|#([A-Fa-f0-9]{3}){2}[A-Fa-f0-9]{2}(?![A-Za-z0-9_]+)");
+static const QRegularExpression cssAtRuleExp = precompiled ("^\\s*@[A-Za-z-]+\\s+|;\\s*@[A-Za-z-]+\\s+");
+static const QRegularExpression mdHeadingExp = precompiled ("^#+\\s+.*");
+static const QRegularExpression mdCodeExp = precompiled ("^( {4,}|\\s*\\t+\\s*).*");
+static const QRegularExpression xmlQuoteExp = precompiled ("\"|&quot;|\'");
+static const QRegularExpression xmlDoubleQuoteExp = precompiled ("\"|&quot;");
+static const QRegularExpression perlHereDocExp = precompiled ("<<([A-Za-z0-9_]+)(?:;)|<<(\'[A-Za-z0-9_]+\')(?:;)|<<(\"[A-Za-z0-9_]+\")(?:;)");
+static const QRegularExpression rubyHereDocExp = precompiled ("<<(?:-|~){0,1}([A-Za-z0-9_]+)|<<(\'[A-Za-z0-9_]+\')|<<(\"[A-Za-z0-9_]+\")");
+static const QRegularExpression cppHereDocExp = precompiled ("<<([A-Za-z0-9_]+)|<<(\'[A-Za-z0-9_]+\')|<<(\"[A-Za-z0-9_]+\")");
+static const QRegularExpression shCommentExp = precompiled ("^#.*|\\s+#.*");
+static const QRegularExpression hashCommentExp = precompiled ("#.*");
+static const QRegularExpression nonWordExp = precompiled ("\\W+");
+static const QRegularExpression debFieldExp = precompiled ("^[^\\s:]+:(?=\\s*)");
+static const QRegularExpression debFieldNameExp = precompiled ("^[^\\s:]+(?=:)");
+static const QRegularExpression leadingSpaceExp = precompiled ("^\\s+");
+static const QRegularExpression debParenExp = precompiled ("\\([^\\(\\)\\[\\]]+\\)|\\[[^\\(\\)\\[\\]]+\\]");
+static const QRegularExpression debRelationExp = precompiled ("<|>|\\=|~");
+static const QRegularExpression xmlValueStartExp = precompiled ("(>|&gt;)");
+static const QRegularExpression xmlValueEndExp = precompiled ("(<|&lt;)");
+static const QRegularExpression mdBlockQuoteStartExp = precompiled ("^>.*");
+static const QRegularExpression emptyLineExp = precompiled ("^$");
+static const QRegularExpression mdCodeBlockStartExp = precompiled ("^```[^\\s`]*$");
+static const QRegularExpression mdCodeBlockEndExp = precompiled ("^```$");
+
+static inline bool isWordChar (const QChar ch)
 {
-    while (!allParentheses.isEmpty())
+    const ushort c = ch.unicode();
+    return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_');
+}
+/*************************/
+// Returns the starts and lengths of the maximal runs of word characters,
+// i.e., of the only substrings that can match "\b(word1|word2|...)\b".
+static QVector<QPair<int, int> > wordRuns (const QString &text)
+{
+    QVector<QPair<int, int> > words;
+    const int n = text.size();
+    int i = 0;
+    while (i < n)
     {
-        ParenthesisInfo *info = allParentheses.at (0);
-        allParentheses.remove (0);
-        delete info;
+        if (!isWordChar (text.at (i)))
+        {
+            ++i;
+            continue;
+        }
+        int start = i;
+        while (i < n && isWordChar (text.at (i)))
+            ++i;
+        words.append (qMakePair (start, i - start));
     }
-    while (!allBraces.isEmpty())
+    return words;
+}
+/*************************/
+// Finds the keywords and the excluded characters of a pattern like
+// "\b(word1|word2)(?!(\.|-|@|#|\$))\b". Returns false for other patterns.
+static bool parseKeywordPattern (const QString &pattern, QStringList &keywords, QString &excluded)
+{
+    if (!pattern.startsWith ("\\b") || !pattern.endsWith ("\\b"))
+        return false;
+    QString p = pattern.mid (2, pattern.size() - 4);
+    QString exclusions;
+    int i = p.indexOf ("(?!(");
+    if (i > -1)
     {
-        BraceInfo *info = allBraces.at (0);
-        allBraces.remove(0);
-        delete info;
+        if (!p.endsWith ("))"))
+            return false;
+        exclusions = p.mid (i + 4, p.size() - i - 6);
+        p.truncate (i);
     }
-    while (!allBrackets.isEmpty())
+    if (p.startsWith ('(') && p.endsWith (')'))
+        p = p.mid (1, p.size() - 2);
+
+    keywords = p.split ('|');
+    for (const QString &word : static_cast<const QStringList&>(keywords))
     {
-        BracketInfo *info = allBrackets.at (0);
-        allBrackets.remove(0);
-        delete info;
+        if (word.isEmpty())
+            return false;
+        for (const QChar &ch : word)
+        {
+            if (!isWordChar (ch))
+                return false;
+        }
     }
+
+    excluded.clear();
+    if (!exclusions.isEmpty())
+    {
+        static const QString special ("\\^$.|?*+()[]{}");
+        const QStringList chars = exclusions.split ('|');
+        for (const QString &c : chars)
+        {
+            if (c.size() == 1 && !special.contains (c.at (0)))
+                excluded += c.at (0);
+            else if (c.size() == 2 && c.at (0) == '\\' && special.contains (c.at (1)))
+                excluded += c.at (1);
+            else
+                return false;
+        }
+    }
+    return true;
 }
 /*************************/
-QVector<ParenthesisInfo *> TextBlockData::parentheses() const
+static bool isKeyword (const QStringList &keywords, const QStringRef &word)
 {
-    return allParentheses;
+    int l = 0, r = keywords.size();
+    while (l < r)
+    {
+        int m = (l + r) / 2;
+        int c = word.compare (keywords.at (m));
+        if (c == 0)
+            return true;
+        if (c < 0)
+            r = m;
+        else
+            l = m + 1;
+    }
+    return false;
 }
 /*************************/
-QVector<BraceInfo *> TextBlockData::braces() const
+// Finds the format runs of block texts with the main rules of a highlighter.
+// It only uses copies of the texts and rules and doesn't touch the document.
+class Tokenizer : public QThread
 {
-    return allBraces;
+public:
+    Tokenizer (const QStringList &texts, const QVector<Highlighter::HighlightingRule> &rules) :
+        texts_ (texts),
+        rules_ (rules) {}
+
+    const QVector<QPair<QString, QVector<Highlighter::FormatRun> > >& results() const {
+        return results_;
+    }
+
+protected:
+    void run() {
+        for (const QString &text : static_cast<const QStringList&>(texts_))
+        {
+            if (isInterruptionRequested())
+                return;
+            results_.append (qMakePair (text, Highlighter::formatRuns (text, rules_)));
+        }
+    }
+
+private:
+    QStringList texts_;
+    QVector<Highlighter::HighlightingRule> rules_;
+    QVector<QPair<QString, QVector<Highlighter::FormatRun> > > results_;
+};
+
+static const int MAX_CACHED_TEXTS = 10000; // the maximum number of cached block texts
+static const int MAX_TOKENIZED_BLOCKS = 1000; // the maximum number of blocks given to the tokenizer
+static const int CASCADE_BUDGET = 10; // the time (in ms) before off-screen blocks are deferred
+static const int DEFER_INTERVAL = 200; // the idle time (in ms) before deferred blocks are re-highlighted
+static const int IDLE_INTERVAL = 500; // the idle time (in ms) before the whole text is highlighted
+static const int IDLE_SLICE = 5; // the time (in ms) of each step of highlighting the whole text
+static const int BRACKET_CHUNK = 64; // the number of blocks summarized in the bracket index
+
+static inline bool isOpenBracket (const char c)
+{
+    return c == '(' || c == '{' || c == '[';
+}
+
+/* depths of the range "a" followed by the range "b" */
+static inline BracketDepths joinDepths (const BracketDepths &a, const BracketDepths &b)
+{
+    BracketDepths d;
+    d.delta = a.delta + b.delta;
+    d.minPrefix = qMin (a.minPrefix, a.delta + b.minPrefix);
+    d.maxSuffix = qMax (b.maxSuffix, b.delta + a.maxSuffix);
+    return d;
+}
+
+int TextBlockData::firstBracket (BracketKind kind) const
+{
+    int first = 0;
+    for (int k = parenthesisKind; k < kind; ++k)
+        first += BracketCounts[k];
+    return first;
 }
 /*************************/
-QVector<BracketInfo *> TextBlockData::brackets() const
+int TextBlockData::bracketCount (BracketKind kind) const
+{
+    return BracketCounts[kind];
+}
+/*************************/
+const BracketInfo &TextBlockData::bracketAt (BracketKind kind, int i) const
+{
+    return allBrackets.at (firstBracket (kind) + i);
+}
+/*************************/
+/* depths of the brackets in [first, end) */
+static BracketDepths rangeDepths (const BracketInfo *first, const BracketInfo *end)
+{
+    BracketDepths d = {0, 0, 0};
+    for (const BracketInfo *b = first; b < end; ++b)
+    {
+        d.delta += isOpenBracket (b->character) ? 1 : -1;
+        d.minPrefix = qMin (d.minPrefix, d.delta);
+    }
+    int suffix = 0;
+    for (const BracketInfo *b = end - 1; b >= first; --b)
+    {
+        suffix += isOpenBracket (b->character) ? 1 : -1;
+        d.maxSuffix = qMax (d.maxSuffix, suffix);
+    }
+    return d;
+}
+
+BracketDepths TextBlockData::bracketDepths (BracketKind kind) const
 {
-    return allBrackets;
+    const BracketInfo *first = allBrackets.constData() + firstBracket (kind);
+    return rangeDepths (first, first + BracketCounts[kind]);
 }
 /*************************/
 QString TextBlockData::labelInfo() const
@@ -85,45 +283,32 @@ int TextBlockData::openNests() const
     return OpenNests;
 }
 /*************************/
-QSet<int> TextBlockData::openQuotes() const
+const QVector<int> &TextBlockData::openQuotes() const
 {
     return OpenQuotes;
 }
 /*************************/
-void TextBlockData::insertInfo (ParenthesisInfo *info)
+bool TextBlockData::hasOpenQuote (int nest) const
 {
-    int i = 0;
-    while (i < allParentheses.size()
-           && info->position > allParentheses.at (i)->position)
-    {
-        ++i;
-    }
-
-    allParentheses.insert (i, info);
+    return std::binary_search (OpenQuotes.constBegin(), OpenQuotes.constEnd(), nest);
 }
 /*************************/
-void TextBlockData::insertInfo (BraceInfo *info)
+void TextBlockData::insertInfo (char character, int position)
 {
-    int i = 0;
-    while (i < allBraces.size()
-           && info->position > allBraces.at (i)->position)
-    {
+    BracketKind kind = character == '(' || character == ')' ? parenthesisKind
+                       : character == '{' || character == '}' ? braceKind
+                                                              : squareBracketKind;
+    int i = firstBracket (kind);
+    int end = i + BracketCounts[kind];
+    while (i < end && position > allBrackets.at (i).position)
         ++i;
-    }
-
-    allBraces.insert (i, info);
-}
-/*************************/
-void TextBlockData::insertInfo (BracketInfo *info)
-{
-    int i = 0;
-    while (i < allBrackets.size()
-           && info->position > allBrackets.at (i)->position)
-    {
-        ++i;
-    }
 
+    BracketInfo info;
+    info.kind = kind;
+    info.character = character;
+    info.position = position;
     allBrackets.insert (i, info);
+    ++ BracketCounts[kind];
 }
 /*************************/
 void TextBlockData::insertInfo (const QString &str)
@@ -146,9 +331,20 @@ void TextBlockData::insertNestInfo (int nests)
     OpenNests = nests;
 }
 /*************************/
-void TextBlockData::insertOpenQuotes (const QSet<int> &openQuotes)
+// Both vectors are sorted; usually, this block has no open quote yet.
+void TextBlockData::insertOpenQuotes (const QVector<int> &openQuotes)
 {
-    OpenQuotes.unite (openQuotes);
+    if (OpenQuotes.isEmpty())
+    {
+        OpenQuotes = openQuotes; // implicitly shared
+        return;
+    }
+    for (const int q : openQuotes)
+    {
+        QVector<int>::iterator it = std::lower_bound (OpenQuotes.begin(), OpenQuotes.end(), q);
+        if (it == OpenQuotes.end() || *it != q)
+            OpenQuotes.insert (it, q);
+    }
 }
 /*************************/
 // Here, the order of formatting is important because of overrides.
@@ -157,6 +353,28 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
                           bool darkColorScheme,
                           bool showWhiteSpace, bool showEndings) : QSyntaxHighlighter (parent)
 {
+    tokenizer = nullptr;
+    tokenizingPending = false;
+    langId = noLanguage;
+    lexerStages = 0;
+
+    lastHighlighted = -2;
+    initialPass = true;
+    deferring = false;
+    deferTimer = new QTimer (this);
+    deferTimer->setSingleShot (true);
+    connect (deferTimer, &QTimer::timeout, this, &Highlighter::rehighlightDeferred);
+
+    idleFormatting = false;
+    lastRevision = parent->revision();
+    idleCursor = QTextCursor (parent);
+    idleCursor.setKeepPositionOnInsert (true);
+    lastBlockCount = parent->blockCount();
+    idleTimer = new QTimer (this);
+    idleTimer->setSingleShot (true);
+    connect (idleTimer, &QTimer::timeout, this, &Highlighter::highlightIdle);
+    connect (parent, &QTextDocument::contentsChange, this, &Highlighter::onContentsChange);
+
     if (lang.isEmpty()) return;
 
     if (showWhiteSpace || showEndings)
@@ -182,6 +400,7 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
     startCursor = start;
     endCursor = end;
     progLan = lang;
+    langId = languageId (lang);
 
     quoteMark.setPattern ("\""); // the standard quote mark
 
@@ -242,12 +461,12 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
      *************/
 
     /* there may be javascript inside html */
-    QString Lang = progLan == "html" ? "javascript" : progLan;
+    QString Lang = langId == htmlLanguage ? "javascript" : progLan;
 
     /* may be overridden by the keywords format */
-    if (progLan == "c" || progLan == "cpp"
-        || progLan == "lua" || progLan == "python"
-        || Lang == "javascript" || progLan == "qml" || progLan == "php")
+    if (langId == cLanguage || langId == cppLanguage
+        || langId == luaLanguage || langId == pythonLanguage
+        || Lang == "javascript" || langId == qmlLanguage || langId == phpLanguage)
     {
         QTextCharFormat functionFormat;
         functionFormat.setFontItalic (true);
@@ -257,14 +476,14 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
         rule.format = functionFormat;
         highlightingRules.append (rule);
         /* ... but make exception for what comes after "#define" */
-        if (progLan == "c" || progLan == "cpp")
+        if (langId == cLanguage || langId == cppLanguage)
         {
             rule.pattern.setPattern ("^\\s*#\\s*define\\s+[^\"\']" // may contain slash but no quote
                                     "+(?=\\s*\\()");
             rule.format = neutralFormat;
             highlightingRules.append (rule);
         }
-        else if (progLan == "python")
+        else if (langId == pythonLanguage)
         { // built-in functions
             functionFormat.setFontWeight (QFont::Bold);
             functionFormat.setForeground (Qt::magenta);
@@ -281,9 +500,9 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
     /* keywords */
     QTextCharFormat keywordFormat;
     /* bash extra keywords */
-    if (progLan == "sh" || progLan == "makefile" || progLan == "cmake")
+    if (langId == shLanguage || langId == makefileLanguage || langId == cmakeLanguage)
     {
-        if (progLan == "cmake")
+        if (langId == cmakeLanguage)
         {
             keywordFormat.setForeground (Brown);
             rule.pattern.setPattern ("\\$\\{\\s*[A-Za-z0-9_.+/\\?#\\-:]*\\s*\\}");
@@ -329,7 +548,7 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
         highlightingRules.append (rule);
     }
 
-    if (progLan == "qmake")
+    if (langId == qmakeLanguage)
     {
         QTextCharFormat qmakeFormat;
         /* qmake test functions */
@@ -365,14 +584,14 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
     urlFormat.setForeground (Blue);
     urlFormat.setFontItalic (true);
 
-    if (progLan == "c" || progLan == "cpp")
+    if (langId == cLanguage || langId == cppLanguage)
     {
         QTextCharFormat cFormat;
 
         /* Qt and Gtk+ specific classes */
         cFormat.setFontWeight (QFont::Bold);
         cFormat.setForeground (DarkMagenta);
-        if (progLan == "cpp")
+        if (langId == cppLanguage)
             rule.pattern.setPattern ("\\bQ[A-Za-z]+(?!(\\.|-|@|#|\\$))\\b");
         else
             rule.pattern.setPattern ("\\bG[A-Za-z]+(?!(\\.|-|@|#|\\$))\\b");
@@ -380,7 +599,7 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
         highlightingRules.append (rule);
 
         /* QtGlobal functions and enum Qt::GlobalColor */
-        if (progLan == "cpp")
+        if (langId == cppLanguage)
         {
             cFormat.setFontItalic (true);
             rule.pattern.setPattern ("\\bq(App)(?!(\\@|#|\\$))\\b|\\bq(Abs|Bound|Critical|Debug|Fatal|FuzzyCompare|InstallMsgHandler|MacVersion|Max|Min|Round64|Round|Version|Warning|getenv|putenv|rand|srand|tTrId|_check_ptr|t_set_sequence_auto_mnemonic|t_symbian_exception2Error|t_symbian_exception2LeaveL|t_symbian_throwIfError)(?!(\\.|-|@|#|\\$))\\b");
@@ -400,7 +619,7 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
         rule.format = cFormat;
         highlightingRules.append (rule);
     }
-    else if (progLan == "python")
+    else if (langId == pythonLanguage)
     {
         QTextCharFormat pFormat;
         pFormat.setFontWeight (QFont::Bold);
@@ -409,7 +628,7 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
         rule.format = pFormat;
         highlightingRules.append (rule);
     }
-    else if (progLan == "qml")
+    else if (langId == qmlLanguage)
     {
         QTextCharFormat qmlFormat;
         qmlFormat.setFontWeight (QFont::Bold);
@@ -418,7 +637,7 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
         rule.format = qmlFormat;
         highlightingRules.append (rule);
     }
-    else if (progLan == "xml")
+    else if (langId == xmlLanguage)
     {
         QTextCharFormat xmlElementFormat;
         xmlElementFormat.setFontWeight (QFont::Bold);
@@ -441,7 +660,7 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
         rule.format = keywordFormat;
         highlightingRules.append (rule);
     }
-    else if (progLan == "changelog")
+    else if (langId == changelogLanguage)
     {
         /* before colon */
         rule.pattern.setPattern ("^\\s+\\*\\s+[^:]+:");
@@ -459,11 +678,11 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
         rule.format = urlFormat;
         highlightingRules.append (rule);
     }
-    else if (progLan == "sh" || progLan == "makefile" || progLan == "cmake"
-             || progLan == "perl" || progLan == "ruby")
+    else if (langId == shLanguage || langId == makefileLanguage || langId == cmakeLanguage
+             || langId == perlLanguage || langId == rubyLanguage)
     {
         /* # is the sh comment sign when it doesn't follow a character */
-        if (progLan == "sh" || progLan == "makefile" || progLan == "cmake")
+        if (langId == shLanguage || langId == makefileLanguage || langId == cmakeLanguage)
             rule.pattern.setPattern ("^#.*|\\s+#.*");
         else
             rule.pattern.setPattern ("#.*");
@@ -472,7 +691,7 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
 
         QTextCharFormat shFormat;
 
-        if (progLan == "sh" || progLan == "makefile" || progLan == "cmake")
+        if (langId == shLanguage || langId == makefileLanguage || langId == cmakeLanguage)
         {
             /* make parentheses and ; neutral as they were in keyword patterns */
             rule.pattern.setPattern ("[\\(\\);]");
@@ -481,7 +700,7 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
 
             shFormat.setForeground (Blue);
             /* words before = */
-             if (progLan == "sh")
+             if (langId == shLanguage)
                  rule.pattern.setPattern ("\\b[A-Za-z0-9_]+(?=\\=)");
              else
                  rule.pattern.setPattern ("\\b[A-Za-z0-9_]+\\s*(?=\\+{0,1}\\=)");
@@ -495,7 +714,7 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
             highlightingRules.append (rule);
         }
 
-        if (progLan == "makefile" || progLan == "cmake")
+        if (langId == makefileLanguage || langId == cmakeLanguage)
         {
             shFormat.setForeground (DarkYellow);
             /* automake/autoconf variables */
@@ -510,7 +729,7 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
         rule.format = shFormat;
         highlightingRules.append (rule);
 
-        if (progLan == "sh" || progLan == "makefile" || progLan == "cmake")
+        if (langId == shLanguage || langId == makefileLanguage || langId == cmakeLanguage)
         {
             shFormat.setFontWeight (QFont::Bold);
             /* brackets */
@@ -519,7 +738,7 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
             highlightingRules.append (rule);
         }
     }
-    else if (progLan == "diff")
+    else if (langId == diffLanguage)
     {
         QTextCharFormat diffMinusFormat;
         diffMinusFormat.setForeground (Red);
@@ -540,7 +759,7 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
         rule.format = diffLinesFormat;
         highlightingRules.append (rule);
     }
-    else if (progLan == "log")
+    else if (langId == logLanguage)
     {
         /* example:
          * May 19 02:01:44 debian sudo:
@@ -585,7 +804,7 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
         rule.format = logRootFormat;
         highlightingRules.append (rule);
     }
-    else if (progLan == "srt")
+    else if (langId == srtLanguage)
     {
         QTextCharFormat srtFormat;
         srtFormat.setFontWeight (QFont::Bold);
@@ -627,10 +846,10 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
         rule.format = srtFormat;
         highlightingRules.append (rule);
     }
-    else if (progLan == "desktop" || progLan == "config" || progLan == "theme")
+    else if (langId == desktopLanguage || langId == configLanguage || langId == themeLanguage)
     {
         QTextCharFormat desktopFormat = neutralFormat;
-        if (progLan == "config")
+        if (langId == configLanguage)
         {
             desktopFormat.setFontWeight (QFont::Bold);
             desktopFormat.setFontItalic (true);
@@ -671,13 +890,13 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
         rule.format = desktopFormat;
         highlightingRules.append (rule);
     }
-    else if (progLan == "url")
+    else if (langId == urlLanguage)
     {
         rule.pattern.setPattern (urlPattern.pattern());
         rule.format = urlFormat;
         highlightingRules.append (rule);
     }
-    else if (progLan == "gtkrc")
+    else if (langId == gtkrcLanguage)
     {
         QTextCharFormat gtkrcFormat;
         gtkrcFormat.setFontWeight (QFont::Bold);
@@ -692,7 +911,7 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
         rule.format = gtkrcFormat;
         highlightingRules.append (rule);
     }
-    else if (progLan == "markdown")
+    else if (langId == markdownLanguage)
     {
         quoteMark.setPattern ("`"); // inline code is almost like a single-line quote
         blockQuoteFormat.setForeground (DarkGreen);
@@ -767,7 +986,7 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
         rule.format = markdownFormat;
         highlightingRules.append (rule);
     }
-    else if (progLan == "lua")
+    else if (langId == luaLanguage)
     {
         QTextCharFormat luaFormat;
         luaFormat.setFontWeight (QFont::Bold);
@@ -777,7 +996,7 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
         rule.format = luaFormat;
         highlightingRules.append (rule);
     }
-    else if (progLan == "m3u")
+    else if (langId == m3uLanguage)
     {
         QTextCharFormat plFormat = neutralFormat;
         plFormat.setFontWeight (QFont::Bold);
@@ -808,7 +1027,7 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
         rule.format = plFormat;
         highlightingRules.append (rule);
     }
-    else if (progLan == "scss")
+    else if (langId == scssLanguage)
     {
         /* scss supports nested css blocks but, instead of making its highlighting complex,
            we format it without considering that and so, without syntax error, but with keywords() */
@@ -864,32 +1083,32 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
 
     /* single line comments */
     rule.pattern.setPattern (QString());
-    if (progLan == "c" || progLan == "cpp" || Lang == "javascript"
-        || progLan == "qml" || progLan == "php" || progLan == "scss")
+    if (langId == cLanguage || langId == cppLanguage || Lang == "javascript"
+        || langId == qmlLanguage || langId == phpLanguage || langId == scssLanguage)
     {
         rule.pattern.setPattern ("//.*"); // why had I set it to ("//(?!\\*).*")?
     }
-    else if (progLan == "python"
-             || progLan == "qmake"
-             || progLan == "gtkrc")
+    else if (langId == pythonLanguage
+             || langId == qmakeLanguage
+             || langId == gtkrcLanguage)
     {
         rule.pattern.setPattern ("#.*"); // or "#[^\n]*"
     }
-    else if (progLan == "desktop" || progLan == "config")
+    else if (langId == desktopLanguage || langId == configLanguage)
     {
         rule.pattern.setPattern ("^\\s*#.*"); // only at start
     }
-    /*else if (progLan == "deb")
+    /*else if (langId == debLanguage)
     {
         rule.pattern.setPattern ("^#[^\\s:]+:(?=\\s*)");
     }*/
-    else if (progLan == "m3u")
+    else if (langId == m3uLanguage)
     {
         rule.pattern.setPattern ("^\\s+#|^#(?!(EXTM3U|EXTINF))");
     }
-    else if (progLan == "lua")
+    else if (langId == luaLanguage)
         rule.pattern.setPattern ("--(?!\\[).*");
-    else if (progLan == "troff")
+    else if (langId == troffLanguage)
         rule.pattern.setPattern ("\\\\\"|\\.\\s*\\\\\"");
     if (!rule.pattern.pattern().isEmpty())
     {
@@ -898,44 +1117,539 @@ Highlighter::Highlighter (QTextDocument *parent, const QString& lang,
     }
 
     /* multiline comments */
-    if (progLan == "c" || progLan == "cpp" || progLan == "javascript"
-        || progLan == "qml" || progLan == "php"
-        || progLan == "css" || progLan == "scss")
+    const Lexer l = lexer (langId);
+    lexerStages = l.stages;
+    commentStartExpression = l.commentStart;
+    commentEndExpression = l.commentEnd;
+    if (langId == markdownLanguage)
+    {
+        quoteFormat.setForeground (DarkRed); // not a quote but a code block
+        urlInsideQuoteFormat.setForeground (DarkRed);
+    }
+
+    /* The rules of a language (with a color scheme) are the same for all highlighters.
+       Copies of a regular expression share its compiled pattern. So, the rules of
+       the first highlighter are optimized and kept to be shared by later ones, which
+       will have their patterns compiled already instead of compiling them again. */
+    static QHash<QString, QPair<QVector<HighlightingRule>, QVector<HighlightingRule> > > sharedRules;
+    const QString key = darkColorScheme ? progLan + "-dark" : progLan;
+    QHash<QString, QPair<QVector<HighlightingRule>, QVector<HighlightingRule> > >::const_iterator it = sharedRules.constFind (key);
+    if (it != sharedRules.constEnd())
+    {
+        highlightingRules = it.value().first;
+        mainRules = it.value().second;
+    }
+    else
+    {
+#if QT_VERSION >= 0x050400
+        for (int i = 0; i < highlightingRules.size(); ++i)
+            highlightingRules[i].pattern.optimize();
+#endif
+        mainRules = keywordRules (highlightingRules);
+        sharedRules.insert (key, qMakePair (highlightingRules, mainRules));
+    }
+}
+/*************************/
+// Converts simple keyword patterns to keyword rules and merges the consecutive
+// ones with the same format and excluded characters. Then, instead of searching
+// a block once per keyword pattern, its words are found once and looked up.
+QVector<Highlighter::HighlightingRule> Highlighter::keywordRules (const QVector<HighlightingRule> &rules) const
+{
+    QVector<HighlightingRule> res;
+    for (const HighlightingRule &r : rules)
     {
-        commentStartExpression.setPattern ("/\\*");
-        commentEndExpression.setPattern ("\\*/");
+        /* single-line comments are formatted before the main formatting */
+        if (r.format == commentFormat)
+            continue;
+        HighlightingRule rule = r;
+        QStringList keywords;
+        QString excluded;
+        if (rule.format != whiteSpaceFormat
+            && parseKeywordPattern (rule.pattern.pattern(), keywords, excluded))
+        {
+            if (!res.isEmpty() && !res.last().keywords.isEmpty()
+                && res.last().format == rule.format && res.last().excluded == excluded)
+            {
+                res.last().keywords << keywords;
+                continue;
+            }
+            rule.pattern = QRegularExpression();
+            rule.keywords = keywords;
+            rule.excluded = excluded;
+        }
+        res.append (rule);
     }
-    else if (progLan == "lua")
+    for (int i = 0; i < res.size(); ++i)
     {
-        commentStartExpression.setPattern ("\\[\\[|--\\[\\[");
-        commentEndExpression.setPattern ("\\]\\]");
+        if (!res.at (i).keywords.isEmpty())
+        {
+            res[i].keywords.sort();
+            res[i].keywords.removeDuplicates();
+        }
+    }
+    return res;
+}
+/*************************/
+// Finds the matches of the rules in a text, in the order of the rules. As
+// with searching by a rule, the matches of each rule don't overlap. This
+// is thread-safe because it uses neither formats nor the document.
+QVector<Highlighter::FormatRun> Highlighter::formatRuns (const QString &text, const QVector<HighlightingRule> &rules)
+{
+    QVector<FormatRun> runs;
+    QVector<QPair<int, int> > words;
+    bool wordsFound (false);
+    for (int i = 0; i < rules.size(); ++i)
+    {
+        const HighlightingRule &rule = rules.at (i);
+        if (!rule.keywords.isEmpty())
+        { // the words of the text are found only once
+            if (!wordsFound)
+            {
+                words = wordRuns (text);
+                wordsFound = true;
+            }
+            for (const QPair<int, int> &word : static_cast<const QVector<QPair<int, int> >&>(words))
+            {
+                int end = word.first + word.second;
+                if (end < text.size() && rule.excluded.contains (text.at (end)))
+                    continue;
+                if (isKeyword (rule.keywords, text.midRef (word.first, word.second)))
+                    runs.append ({word.first, word.second, i});
+            }
+            continue;
+        }
+
+        QRegularExpressionMatch match;
+        int index = text.indexOf (rule.pattern, 0, &match);
+        while (index >= 0)
+        {
+            int length = match.capturedLength();
+            runs.append ({index, length, i});
+            index = text.indexOf (rule.pattern, index + qMax (length, 1), &match);
+        }
     }
-    else if (progLan == "python")
+    return runs;
+}
+/*************************/
+// Formats the runs of the main rules that don't start inside quotes or comments.
+void Highlighter::applyFormatRuns (const QVector<FormatRun> &runs)
+{
+    for (const FormatRun &run : runs)
     {
-        commentStartExpression.setPattern ("\"\"\"|\'\'\'");
-        commentEndExpression = commentStartExpression;
+        const QTextCharFormat &ruleFormat = mainRules.at (run.rule).format;
+        int l = run.length;
+        if (ruleFormat != whiteSpaceFormat)
+        {
+            /* skip quotes and all comments */
+            QTextCharFormat fi = format (run.start);
+            if (fi == quoteFormat || fi == altQuoteFormat || fi == urlInsideQuoteFormat
+                || fi == commentFormat || fi == urlFormat
+                || fi == JSRegexFormat)
+            {
+                continue;
+            }
+            /* In c/c++, the neutral pattern after "#define" may contain
+               a (double-)slash but it's always good to check whether a
+               part of the match is inside an already formatted region. */
+            while (format (run.start + l - 1) == commentFormat)
+                -- l;
+        }
+        setFormat (run.start, l, ruleFormat);
+    }
+}
+/*************************/
+// Finds the format runs of the blocks around the visible ones in a worker
+// thread. They'll be formatted without searching when scrolled into view.
+void Highlighter::tokenizeAround (const QTextBlock &start, const QTextBlock &end)
+{
+    if (mainRules.isEmpty() || !start.isValid() || !end.isValid())
+        return;
+    if (tokenizer != nullptr)
+    { // wait for the current blocks to be tokenized
+        tokenizingPending = true;
+        return;
     }
-    else if (progLan == "xml" || progLan == "html")
+
+    /* about two pages after and before the visible text */
+    int count = qMin ((end.blockNumber() - start.blockNumber() + 1) * 2, MAX_TOKENIZED_BLOCKS / 2);
+    QStringList texts;
+    QTextBlock block = end.next();
+    for (int i = 0; i < count && block.isValid(); ++i)
     {
-        commentStartExpression.setPattern ("<!--");
-        commentEndExpression.setPattern ("-->");
+        TextBlockData *data = static_cast<TextBlockData *>(block.userData());
+        if ((data == nullptr || !data->isHighlighted())
+            && block.length() > 1 && !tokenCache.contains (block.text()))
+        {
+            texts << block.text();
+        }
+        block = block.next();
     }
-    else if (progLan == "perl")
+    block = start.previous();
+    for (int i = 0; i < count && block.isValid(); ++i)
     {
-        commentStartExpression.setPattern ("^=[A-Za-z0-9_]+($|\\s+)");
-        commentEndExpression.setPattern ("^=cut.*");
+        TextBlockData *data = static_cast<TextBlockData *>(block.userData());
+        if ((data == nullptr || !data->isHighlighted())
+            && block.length() > 1 && !tokenCache.contains (block.text()))
+        {
+            texts << block.text();
+        }
+        block = block.previous();
+    }
+    if (texts.isEmpty()) return;
+
+    tokenizer = new Tokenizer (texts, mainRules);
+    connect (tokenizer, &QThread::finished, this, &Highlighter::onTokenized);
+    tokenizer->start();
+}
+/*************************/
+void Highlighter::onTokenized()
+{
+    if (tokenizer == nullptr) return;
+    tokenizer->wait(); // "finished()" is emitted just before the thread finishes
+    if (tokenCache.size() + tokenizer->results().size() > MAX_CACHED_TEXTS)
+        tokenCache.clear();
+    const QVector<QPair<QString, QVector<FormatRun> > > &results = tokenizer->results();
+    for (const QPair<QString, QVector<FormatRun> > &result : results)
+        tokenCache.insert (result.first, result.second);
+    delete tokenizer;
+    tokenizer = nullptr;
+
+    if (tokenizingPending)
+    { // the visible text has changed in the meantime
+        tokenizingPending = false;
+        tokenizeAround (startCursor.block(), endCursor.block());
     }
-    else if (progLan == "markdown")
+}
+/*************************/
+// Re-highlights the block soon if it's visible and at an idle time otherwise.
+// Off-screen blocks are kept in the order of their positions, and each of them
+// starts a cascade of its own, which may not be covered by the previous ones.
+void Highlighter::rehighlightLater (const QTextBlock &block)
+{
+    if (!block.isValid()) return;
+    if (block.blockNumber() <= endCursor.blockNumber())
     {
-        quoteFormat.setForeground (DarkRed); // not a quote but a code block
-        urlInsideQuoteFormat.setForeground (DarkRed);
-        commentStartExpression.setPattern ("<!--");
-        commentEndExpression.setPattern ("-->");
+        QMetaObject::invokeMethod (this, "rehighlightBlock", Qt::QueuedConnection, Q_ARG (QTextBlock, block));
+        return;
     }
+    const int pos = block.position();
+    QList<QTextCursor>::iterator it = deferredCursors.begin();
+    while (it != deferredCursors.end() && it->position() < pos)
+        ++it;
+    if (it == deferredCursors.end() || it->position() != pos)
+    {
+        QTextCursor cursor (block);
+        cursor.setKeepPositionOnInsert (true);
+        deferredCursors.insert (it, cursor);
+    }
+    /* continue a deferred re-highlighting immediately but wait for an idle time otherwise */
+    deferTimer->start (deferring ? 0 : DEFER_INTERVAL);
+}
+/*************************/
+// QSyntaxHighlighter goes on highlighting the next blocks as long as the block
+// state changes, which may cover the whole document after an edit. Here, if the
+// highlighting has taken too long and the current block is off-screen, the
+// cascade is stopped by restoring the old state of the block (its checkpoint)
+// and the block is re-highlighted later, when the rest will be re-highlighted
+// until the new state converges with the stored one. The checkpoint includes
+// the open nests and quotes of the block, which are used by the next block
+// without changing its state; if only they have changed, the next block is
+// re-highlighted later.
+void Highlighter::deferCascade (int oldState, int oldOpenNests, const QVector<int> &oldOpenQuotes)
+{
+    QTextBlock block = currentBlock();
+    int bn = block.blockNumber();
+    if (bn != lastHighlighted + 1) // a new cascade
+        cascadeTimer.start();
+    lastHighlighted = bn;
+
+    if (initialPass)
+    { // the whole document is highlighted for the first time
+        if (block == document()->lastBlock())
+        {
+            initialPass = false;
+            idleTimer->start (IDLE_INTERVAL);
+        }
+        return;
+    }
+
+    if (bn <= endCursor.blockNumber() || cascadeTimer.elapsed() < CASCADE_BUDGET)
+        return;
+    if (oldState != currentBlockState())
+    {
+        setCurrentBlockState (oldState);
+        rehighlightLater (block);
+        return;
+    }
+    TextBlockData *data = static_cast<TextBlockData *>(currentBlockUserData());
+    if (data != nullptr
+        && (data->openNests() != oldOpenNests || data->openQuotes() != oldOpenQuotes))
+    {
+        rehighlightLater (block.next());
+    }
+}
+/*************************/
+void Highlighter::rehighlightDeferred()
+{
+    if (deferredCursors.isEmpty()) return;
+    QTextBlock block = deferredCursors.takeFirst().block();
+    /* edits may have merged the deferred blocks */
+    while (!deferredCursors.isEmpty() && deferredCursors.first().block() == block)
+        deferredCursors.removeFirst();
+    if (!deferredCursors.isEmpty())
+        deferTimer->start (0); // resume the next cascade in the next cycle of the event loop
+    if (!block.isValid()) return;
+    deferring = true;
+    rehighlightBlock (block);
+    deferring = false;
+}
+/*************************/
+// Highlights the blocks that aren't completely highlighted in a small time slice
+// and continues in the next event loop iteration. Edits postpone the next slice.
+void Highlighter::highlightIdle()
+{
+    if (progLan.isEmpty()) return;
+    if (!deferredCursors.isEmpty())
+    { // the block states should be updated first
+        idleTimer->start (IDLE_INTERVAL);
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QTextBlock block = idleCursor.block();
+    while (block.isValid() && timer.elapsed() < IDLE_SLICE)
+    {
+        TextBlockData *data = static_cast<TextBlockData *>(block.userData());
+        if (data != nullptr && !data->isHighlighted())
+        {
+            idleFormatting = true;
+            rehighlightBlock (block);
+            idleFormatting = false;
+        }
+        block = block.next();
+    }
+
+    if (block.isValid())
+    {
+        idleCursor.setPosition (block.position());
+        idleTimer->start (0);
+    }
+    else
+        idleCursor.movePosition (QTextCursor::End);
+}
+/*************************/
+void Highlighter::onContentsChange (int pos)
+{
+    if (progLan.isEmpty()) return;
+    /* applying formats changes the contents too but not the revision */
+    int revision = document()->revision();
+    if (revision == lastRevision) return;
+    lastRevision = revision;
+
+    /* the blocks after the edit are renumbered */
+    int blockCount = document()->blockCount();
+    if (blockCount != lastBlockCount)
+    {
+        lastBlockCount = blockCount;
+        int chunk = document()->findBlock (pos).blockNumber() / BRACKET_CHUNK;
+        if (chunk >= 0 && chunk * 3 < bracketChunks.size())
+            bracketChunks.resize (chunk * 3);
+    }
+
+    if (initialPass) return;
+
+    /* the blocks after the edit may be re-highlighted partially */
+    if (pos < idleCursor.position())
+        idleCursor.setPosition (pos);
+    idleTimer->start (IDLE_INTERVAL);
+}
+/*************************/
+void Highlighter::invalidateBracketChunk (int bn)
+{
+    int i = (bn / BRACKET_CHUNK) * 3;
+    if (i < bracketChunks.size())
+    {
+        for (int k = parenthesisKind; k <= squareBracketKind; ++k)
+            bracketChunks[i + k].minPrefix = 1; // not computed
+    }
+}
+/*************************/
+// Finds the brackets of a kind in a block. A block that isn't highlighted yet
+// has no bracket info; its brackets are found in its text, although those
+// inside comments and quotes can't be excluded before it's highlighted.
+static void blockBrackets (const QTextBlock &block, BracketKind kind, QVarLengthArray<BracketInfo, 4> &brackets)
+{
+    brackets.clear();
+    if (TextBlockData *data = static_cast<TextBlockData *>(block.userData()))
+    {
+        int count = data->bracketCount (kind);
+        for (int i = 0; i < count; ++i)
+            brackets.append (data->bracketAt (kind, i));
+        return;
+    }
+    const char open = kind == parenthesisKind ? '(' : kind == braceKind ? '{' : '[';
+    const char close = kind == parenthesisKind ? ')' : kind == braceKind ? '}' : ']';
+    const QString text = block.text();
+    for (int i = 0; i < text.length(); ++i)
+    {
+        const QChar c = text.at (i);
+        if (c == QLatin1Char (open) || c == QLatin1Char (close))
+        {
+            BracketInfo info;
+            info.kind = static_cast<char>(kind);
+            info.character = c.toLatin1();
+            info.position = i;
+            brackets.append (info);
+        }
+    }
+}
+/*************************/
+BracketDepths Highlighter::chunkDepths (int chunk, BracketKind kind)
+{
+    int size = bracketChunks.size();
+    if (size < (chunk + 1) * 3)
+    {
+        bracketChunks.resize ((chunk + 1) * 3);
+        for (int i = size; i < bracketChunks.size(); ++i)
+            bracketChunks[i].minPrefix = 1;
+    }
+    BracketDepths &d = bracketChunks[chunk * 3 + kind];
+    if (d.minPrefix > 0)
+    {
+        d.delta = d.minPrefix = d.maxSuffix = 0;
+        QTextBlock block = document()->findBlockByNumber (chunk * BRACKET_CHUNK);
+        QVarLengthArray<BracketInfo, 4> brackets;
+        for (int i = 0; i < BRACKET_CHUNK && block.isValid(); ++i)
+        {
+            if (TextBlockData *data = static_cast<TextBlockData *>(block.userData()))
+                d = joinDepths (d, data->bracketDepths (kind));
+            else
+            {
+                blockBrackets (block, kind, brackets);
+                d = joinDepths (d, rangeDepths (brackets.constData(), brackets.constData() + brackets.size()));
+            }
+            block = block.next();
+        }
+    }
+    return d;
+}
+/*************************/
+// Returns the document position of the bracket matching the one with the
+// given index in the block, or -1 if there's no match. Only the blocks and
+// chunks whose depths show that they contain the match are searched. The
+// blocks that aren't highlighted yet are searched by their texts.
+int Highlighter::matchingBracket (const QTextBlock &block, BracketKind kind, int index, bool forward)
+{
+    if (block.userData() == nullptr) return -1;
+
+    QVarLengthArray<BracketInfo, 4> brackets;
+    blockBrackets (block, kind, brackets);
+    bool inBlock = true; // whether "brackets" are those of the block "b"
+    int depth = 0;
+    int bn = block.blockNumber();
+    QTextBlock b = block;
+    if (forward)
+    {
+        int i = index + 1;
+        while (b.isValid())
+        {
+            if (inBlock)
+            {
+                for (; i < brackets.size(); ++i)
+                {
+                    const BracketInfo &info = brackets.at (i);
+                    depth += isOpenBracket (info.character) ? 1 : -1;
+                    if (depth < 0)
+                        return b.position() + info.position;
+                }
+            }
+
+            /* skip the blocks and chunks that don't contain the match */
+            b = b.next(); ++bn;
+            inBlock = false;
+            while (b.isValid())
+            {
+                if (bn % BRACKET_CHUNK == 0)
+                {
+                    BracketDepths d = chunkDepths (bn / BRACKET_CHUNK, kind);
+                    if (depth + d.minPrefix >= 0)
+                    {
+                        depth += d.delta;
+                        bn += BRACKET_CHUNK;
+                        b = document()->findBlockByNumber (bn);
+                        continue;
+                    }
+                }
+                blockBrackets (b, kind, brackets);
+                BracketDepths d = rangeDepths (brackets.constData(), brackets.constData() + brackets.size());
+                if (depth + d.minPrefix < 0)
+                {
+                    inBlock = true;
+                    break;
+                }
+                depth += d.delta;
+                b = b.next(); ++bn;
+            }
+            i = 0;
+        }
+    }
+    else
+    {
+        int i = index - 1;
+        while (b.isValid())
+        {
+            if (inBlock)
+            {
+                for (; i >= 0; --i)
+                {
+                    const BracketInfo &info = brackets.at (i);
+                    depth += isOpenBracket (info.character) ? -1 : 1;
+                    if (depth < 0)
+                        return b.position() + info.position;
+                }
+            }
+
+            b = b.previous(); --bn;
+            inBlock = false;
+            while (b.isValid())
+            {
+                if (bn % BRACKET_CHUNK == BRACKET_CHUNK - 1)
+                {
+                    BracketDepths d = chunkDepths (bn / BRACKET_CHUNK, kind);
+                    if (depth - d.maxSuffix >= 0)
+                    {
+                        depth -= d.delta;
+                        bn -= BRACKET_CHUNK;
+                        b = document()->findBlockByNumber (bn);
+                        continue;
+                    }
+                }
+                blockBrackets (b, kind, brackets);
+                BracketDepths d = rangeDepths (brackets.constData(), brackets.constData() + brackets.size());
+                if (depth - d.maxSuffix < 0)
+                {
+                    inBlock = true;
+                    break;
+                }
+                depth -= d.delta;
+                b = b.previous(); --bn;
+            }
+            i = brackets.size() - 1;
+        }
+    }
+    return -1;
 }
 /*************************/
 Highlighter::~Highlighter()
 {
+    if (tokenizer != nullptr)
+    {
+        disconnect (tokenizer, &QThread::finished, this, &Highlighter::onTokenized);
+        tokenizer->requestInterruption();
+        tokenizer->wait();
+        delete tokenizer;
+    }
     if (QTextDocument *doc = document())
     {
         QTextOption opt =  doc->defaultTextOption();
@@ -969,11 +1683,11 @@ bool Highlighter::isEscapedQuote (const QString &text, const int pos, bool isSta
 {
     if (pos < 0) return false;
 
-    if (progLan == "html" || progLan == "xml")
+    if (langId == htmlLanguage || langId == xmlLanguage)
         return false;
 
     if (pos != text.indexOf (quoteMark, pos)
-        && (progLan == "markdown" || pos != text.indexOf (QRegularExpression ("\'"), pos)))
+        && (langId == markdownLanguage || pos != text.indexOf (singleQuoteExp, pos)))
     {
         return false;
     }
@@ -983,9 +1697,9 @@ bool Highlighter::isEscapedQuote (const QString &text, const int pos, bool isSta
         && currentBlockState() % 2 == 0)
     {
         QRegularExpressionMatch match;
-        QRegularExpression delimPart ("<<\\s*");
+        QRegularExpression delimPart = hereDocStartExp;
         QRegularExpressionMatch match1;
-        QRegularExpression delimPart1 ("<<(?:\\s*)(\'[A-Za-z0-9_]+)|<<(?:\\s*)(\"[A-Za-z0-9_]+)");
+        QRegularExpression delimPart1 = hereDocQuoteExp;
         if (text.lastIndexOf (delimPart, pos, &match) == pos - match.capturedLength()
             || text.lastIndexOf (delimPart1, pos, &match1) == pos - match1.capturedLength())
         {
@@ -994,44 +1708,39 @@ bool Highlighter::isEscapedQuote (const QString &text, const int pos, bool isSta
     }
 
     /* escaped start quotes are just for Bash, Perl and markdown */
-    if (isStartQuote
-        && progLan != "sh" && progLan != "makefile" && progLan != "cmake"
-        && progLan != "perl" && progLan != "markdown")
+    const int flags = languageFlags (langId);
+    if (isStartQuote && !(flags & hasEscapedStartQuotes))
     {
         return false;
     }
 
     if (isStartQuote && skipCommandSign && pos == text.indexOf (quoteMark, pos)
-        && text.indexOf (QRegularExpression ("[^\"]*\\$\\("), pos)== pos + 1)
+        && text.indexOf (cmdSubstitutionExp, pos)== pos + 1)
     {
         return true;
     }
 
     /* in Perl, $' has a (deprecated?) meaning */
     if (isStartQuote // otherwise undetectable
-        && progLan == "perl" && pos >= 1 && pos - 1 == text.indexOf (QRegularExpression ("\\$"), pos - 1))
+        && langId == perlLanguage && pos >= 1 && pos - 1 == text.indexOf (dollarExp, pos - 1))
     {
         return true;
     }
 
     int i = 0;
-    while (pos - i >= 1 && pos - i - 1 == text.indexOf (QRegularExpression ("\\\\"), pos - i - 1))
+    while (pos - i >= 1 && pos - i - 1 == text.indexOf (backslashExp, pos - i - 1))
         ++i;
     /* only an odd number of backslashes means that the quote is escaped */
     if (
         i % 2 != 0
             /* for perl, only double quote can be escaped? */
-        && (/*(progLan == "perl"
+        && (/*(langId == perlLanguage
              && pos == text.indexOf (quoteMark, pos)) ||*/
-            /* for these languages, both single and double quotes can be escaped */
-            progLan == "cpp" || progLan == "c"
-            || progLan == "python"
-            || progLan == "perl"
-            || progLan == "javascript"
-            /* markdown is an exception */
-            || progLan == "markdown"
+            /* for these languages (c, cpp, python, perl, javascript and
+               markdown), both single and double quotes can be escaped */
+            (flags & hasEscapedQuotes)
             /* however, in Bash, single quote can be escaped only at start */
-            || ((progLan == "sh" || progLan == "makefile" || progLan == "cmake")
+            || ((flags & hasEscapedStartQuotes)
                 && (isStartQuote || pos == text.indexOf (quoteMark, pos))))
        )
     {
@@ -1053,18 +1762,16 @@ bool Highlighter::isQuoted (const QString &text, const int index,
     int pos = -1;
     int N;
     bool mixedQuotes = false;
-    if (progLan == "c" || progLan == "cpp"
-        || progLan == "python" || progLan == "sh"
-        || progLan == "makefile" || progLan == "cmake"
-        || progLan == "lua" || progLan == "perl"
-        || progLan == "xml" // never used with xml; otherwise, we should consider "&quot;"
-        || progLan == "ruby" || progLan == "html" || progLan == "javascript" || progLan == "scss")
+    if ((languageFlags (langId) & hasMixedQuotes)
+        || langId == shLanguage
+        || langId == xmlLanguage // never used with xml; otherwise, we should consider "&quot;"
+        || langId == htmlLanguage)
     {
         mixedQuotes = true;
     }
     QRegularExpression quoteExpression;
     if (mixedQuotes)
-        quoteExpression.setPattern ("\"|\'");
+        quoteExpression = mixedQuoteExp;
     else
         quoteExpression = quoteMark;
     int prevState = previousBlockState();
@@ -1089,7 +1796,7 @@ bool Highlighter::isQuoted (const QString &text, const int index,
                 quoteExpression = quoteMark;
                 if (skipCommandSign)
                 {
-                    if (text.indexOf (QRegularExpression ("[^\"]*\\$\\("), 0) == 0)
+                    if (text.indexOf (cmdSubstitutionExp, 0) == 0)
                     {
                         N = 0;
                         res = false;
@@ -1102,7 +1809,7 @@ bool Highlighter::isQuoted (const QString &text, const int index,
                             if (TextBlockData *prevData = static_cast<TextBlockData *>(prevBlock.userData()))
                             {
                                 int N = prevData->openNests();
-                                if (N > 0 && (prevState == doubleQuoteState || !prevData->openQuotes().contains (N)))
+                                if (N > 0 && (prevState == doubleQuoteState || !prevData->hasOpenQuote (N)))
                                 {
                                     N = 0;
                                     res = false;
@@ -1113,7 +1820,7 @@ bool Highlighter::isQuoted (const QString &text, const int index,
                 }
             }
             else
-                quoteExpression.setPattern ("\'");
+                quoteExpression = singleQuoteExp;
         }
     }
 
@@ -1150,10 +1857,10 @@ bool Highlighter::isQuoted (const QString &text, const int index,
                 if (pos == text.indexOf (quoteMark, pos))
                     quoteExpression = quoteMark;
                 else
-                    quoteExpression.setPattern ("\'");
+                    quoteExpression = singleQuoteExp;
             }
             else
-                quoteExpression.setPattern ("\"|\'");
+                quoteExpression = mixedQuoteExp;
         }
     }
 
@@ -1168,7 +1875,7 @@ bool Highlighter::isMLCommented (const QString &text, const int index, int comSt
     if (commentStartExpression.pattern().isEmpty()) return false;
 
     /* not for Python */
-    if (progLan == "python") return false;
+    if (langId == pythonLanguage) return false;
 
     if (index < 0 || commentStartExpression.pattern().isEmpty())
         return false;
@@ -1232,7 +1939,7 @@ bool Highlighter::isMLCommented (const QString &text, const int index, int comSt
 // It comes after singleLineComment() and before multiLineQuote().
 void Highlighter::pythonMLComment (const QString &text, const int indx)
 {
-    if (progLan != "python") return;
+    if (langId != pythonLanguage) return;
 
     QTextCharFormat noteFormat;
     noteFormat.setFontWeight (QFont::Bold);
@@ -1267,14 +1974,14 @@ void Highlighter::pythonMLComment (const QString &text, const int indx)
         if (index >= indx)
         {
             /* ... distinguish between double and single quotes */
-            if (index == text.indexOf (QRegularExpression ("\"\"\""), index))
+            if (index == text.indexOf (tripleDoubleQuoteExp, index))
             {
-                commentStartExpression.setPattern ("\"\"\"");
+                commentStartExpression = tripleDoubleQuoteExp;
                 quote = pyDoubleQuoteState;
             }
             else
             {
-                commentStartExpression.setPattern ("\'\'\'");
+                commentStartExpression = tripleSingleQuoteExp;
                 quote = pySingleQuoteState;
             }
         }
@@ -1285,9 +1992,9 @@ void Highlighter::pythonMLComment (const QString &text, const int indx)
            by checking the previous line */
         quote = prevState;
         if (quote == pyDoubleQuoteState)
-            commentStartExpression.setPattern ("\"\"\"");
+            commentStartExpression = tripleDoubleQuoteExp;
         else
-            commentStartExpression.setPattern ("\'\'\'");
+            commentStartExpression = tripleSingleQuoteExp;
     }
 
     while (index >= indx)
@@ -1299,12 +2006,12 @@ void Highlighter::pythonMLComment (const QString &text, const int indx)
                again because the quote mark may have changed... */
             if (index == text.indexOf (quoteMark, index))
             {
-                commentStartExpression.setPattern ("\"\"\"");
+                commentStartExpression = tripleDoubleQuoteExp;
                 quote = pyDoubleQuoteState;
             }
             else
             {
-                commentStartExpression.setPattern ("\'\'\'");
+                commentStartExpression = tripleSingleQuoteExp;
                 quote = pySingleQuoteState;
             }
         }
@@ -1322,12 +2029,12 @@ void Highlighter::pythonMLComment (const QString &text, const int indx)
         }
 
         /* check if the quote is escaped */
-        while ((endIndex >= 1 && endIndex  - 1 == text.indexOf (QRegularExpression ("\\\\"), endIndex - 1)
+        while ((endIndex >= 1 && endIndex  - 1 == text.indexOf (backslashExp, endIndex - 1)
                 /* backslash shouldn't be escaped itself */
-                && (endIndex < 2 || endIndex  - 2 != text.indexOf (QRegularExpression ("\\\\"), endIndex - 2)))
+                && (endIndex < 2 || endIndex  - 2 != text.indexOf (backslashExp, endIndex - 2)))
                    /* also consider ^' and ^" */
-                   || ((endIndex >= 1 && endIndex  - 1 == text.indexOf (QRegularExpression ("\\^"), endIndex - 1))
-                       && (endIndex < 2 || endIndex  - 2 != text.indexOf (QRegularExpression ("\\\\"), endIndex - 2))))
+                   || ((endIndex >= 1 && endIndex  - 1 == text.indexOf (caretExp, endIndex - 1))
+                       && (endIndex < 2 || endIndex  - 2 != text.indexOf (backslashExp, endIndex - 2))))
         {
             endIndex = text.indexOf (commentStartExpression, endIndex + 3, &startMatch);
         }
@@ -1362,7 +2069,7 @@ void Highlighter::pythonMLComment (const QString &text, const int indx)
         }
 
         /* the next quote may be different */
-        commentStartExpression.setPattern ("\"\"\"|\'\'\'");
+        commentStartExpression = tripleQuoteExp;
         index = text.indexOf (commentStartExpression, index + quoteLength);
         QTextCharFormat fi = format (index);
         while ((index > 0 && isQuoted (text, index - 1))
@@ -1379,7 +2086,7 @@ void Highlighter::pythonMLComment (const QString &text, const int indx)
 // This should come before multiline comments highlighting.
 int Highlighter::cssHighlighter (const QString &text, bool mainFormatting, const int start)
 {
-    if (progLan != "css") return -1;
+    if (langId != cssLanguage) return -1;
 
     int cssIndx = -1;
     /* CSS can have huge lines, which will take
@@ -1393,11 +2100,11 @@ int Highlighter::cssHighlighter (const QString &text, bool mainFormatting, const
      **************************/
 
     QRegularExpressionMatch cssStartMatch;
-    QRegularExpression cssStartExpression ("\\{");
+    QRegularExpression cssStartExpression = braceStartExp;
     QRegularExpressionMatch cssEndtMatch;
-    QRegularExpression cssEndExpression ("\\}");
+    QRegularExpression cssEndExpression = braceEndExp;
     QRegularExpressionMatch numMatch;
-    QRegularExpression numExpression ("(-|\\+){0,1}\\b\\d*\\.{0,1}\\d+");
+    QRegularExpression numExpression = cssNumberExp;
     int index = start;
 
     QTextCharFormat cssValueFormat;
@@ -1455,7 +2162,7 @@ int Highlighter::cssHighlighter (const QString &text, bool mainFormatting, const
         {
             /* at first, we suppose all syntax is wrong */
             QRegularExpressionMatch match;
-            QRegularExpression expression ("[^\\{\\}\\s]+");
+            QRegularExpression expression = cssSelectorExp;
             int indxTmp = text.indexOf (expression, index, &match);
             while (isQuoted (text, indxTmp))
                 indxTmp = text.indexOf (expression, indxTmp + 1, &match);
@@ -1469,7 +2176,7 @@ int Highlighter::cssHighlighter (const QString &text, bool mainFormatting, const
             QTextCharFormat cssAttFormat;
             cssAttFormat.setFontItalic (true);
             cssAttFormat.setForeground (Blue);
-            expression.setPattern ("[A-Za-z0-9_\\-]+(?=\\s*:.*;*)");
+            expression = cssAttributeExp;
             indxTmp = text.indexOf (expression, index, &match);
             while (isQuoted (text, indxTmp))
                 indxTmp = text.indexOf (expression, indxTmp + 1, &match);
@@ -1487,8 +2194,8 @@ int Highlighter::cssHighlighter (const QString &text, bool mainFormatting, const
      * (Multiline) CSS Values *
      **************************/
 
-    cssStartExpression.setPattern (":");
-    cssEndExpression.setPattern (";|\\}");
+    cssStartExpression = colonExp;
+    cssEndExpression = cssValueEndExp;
     index = 0;
     if (prevState != cssValueState || start > 0)
     {
@@ -1568,7 +2275,7 @@ int Highlighter::cssHighlighter (const QString &text, bool mainFormatting, const
         cssColorFormat.setFontItalic (true);
         QRegularExpressionMatch match;
         // previously: "#\\b([A-Za-z0-9]{3}){0,4}(?![A-Za-z0-9_]+)"
-        QRegularExpression expression ("#([A-Fa-f0-9]{3}){0,2}(?![A-Za-z0-9_]+)|#([A-Fa-f0-9]{3}){2}[A-Fa-f0-9]{2}(?![A-Za-z0-9_]+)");
+        QRegularExpression expression = colorValueExp;
         int indxTmp = text.indexOf (expression, start, &match);
         while (isQuoted (text, indxTmp))
             indxTmp = text.indexOf (expression, indxTmp + 1, &match);
@@ -1585,7 +2292,7 @@ int Highlighter::cssHighlighter (const QString &text, bool mainFormatting, const
         /* definitions (starting with @) */
         QTextCharFormat cssDefinitionFormat;
         cssDefinitionFormat.setForeground (Brown);
-        expression.setPattern ("^\\s*@[A-Za-z-]+\\s+|;\\s*@[A-Za-z-]+\\s+");
+        expression = cssAtRuleExp;
         indxTmp = text.indexOf (expression, start, &match);
         while (isQuoted (text, indxTmp))
             indxTmp = text.indexOf (expression, indxTmp + 1, &match);
@@ -1658,7 +2365,7 @@ void Highlighter::singleLineComment (const QString &text, const int start)
                    no highlighting function is called after singleLineComment()
                    and before the main formaatting in highlightBlock()
                    (only c and c++ for now) */
-                if ((progLan == "c" || progLan == "cpp")
+                if ((langId == cLanguage || langId == cppLanguage)
                     && text.endsWith (QLatin1Char('\\')))
                 {
                     setCurrentBlockState (nextLineCommentState);
@@ -1682,7 +2389,7 @@ void Highlighter::multiLineComment (const QString &text,
 
     /* CSS can have huge lines, which will take
        a lot of CPU time if they're formatted completely. */
-    bool hugeText = ((progLan == "css" || progLan == "scss" ) && text.length() > 50000);
+    bool hugeText = ((langId == cssLanguage || langId == scssLanguage ) && text.length() > 50000);
 
     bool commentBeforeBrace = false; // in css, not as: "{...
     int startIndex = index;
@@ -1713,25 +2420,25 @@ void Highlighter::multiLineComment (const QString &text,
             commentBeforeBrace = true;
 
         /* special handling for markdown */
-        if (progLan == "markdown" && startIndex > 0)
+        if (langId == markdownLanguage && startIndex > 0)
         {
-            if (text.indexOf (QRegularExpression ("^#+\\s+.*"), 0) == 0
-                || text.indexOf (QRegularExpression ("^( {4,}|\\s*\\t+\\s*).*"), 0) == 0)
+            if (text.indexOf (mdHeadingExp, 0) == 0
+                || text.indexOf (mdCodeExp, 0) == 0)
             {
                 return; // no comment start sign inside headings or code blocks
             }
             /* no comment start sign inside footnotes, images or links */
             QRegularExpressionMatch mMatch;
-            QRegularExpression mExp ("\\[\\^[^\\]]+\\]"
-                                     "|"
-                                     "\\!\\[[^\\]\\^]*\\]\\s*"
-                                     "(\\(\\s*[^\\)\\(\\s]+(\\s+\\\".*\\\")*\\s*\\)|\\s*\\[[^\\]]*\\])"
-                                     "|"
-                                     "\\[[^\\]\\^]*\\]\\s*\\[[^\\]\\s]*\\]"
-                                     "|"
-                                     "\\[[^\\]\\^]*\\]\\s*\\(\\s*[^\\)\\(\\s]+(\\s+\\\".*\\\")*\\s*\\)"
-                                     "|"
-                                     "\\[[^\\]\\^]*\\]:\\s+\\s*[^\\)\\(\\s]+(\\s+\\\".*\\\")*");
+            static const QRegularExpression mExp = precompiled ("\\[\\^[^\\]]+\\]"
+                                                                "|"
+                                                                "\\!\\[[^\\]\\^]*\\]\\s*"
+                                                                "(\\(\\s*[^\\)\\(\\s]+(\\s+\\\".*\\\")*\\s*\\)|\\s*\\[[^\\]]*\\])"
+                                                                "|"
+                                                                "\\[[^\\]\\^]*\\]\\s*\\[[^\\]\\s]*\\]"
+                                                                "|"
+                                                                "\\[[^\\]\\^]*\\]\\s*\\(\\s*[^\\)\\(\\s]+(\\s+\\\".*\\\")*\\s*\\)"
+                                                                "|"
+                                                                "\\[[^\\]\\^]*\\]:\\s+\\s*[^\\)\\(\\s]+(\\s+\\\".*\\\")*");
             int mStart = text.indexOf (mExp, 0, &mMatch);
             while (mStart >= 0 && mStart < startIndex)
             {
@@ -1916,19 +2623,14 @@ void Highlighter::multiLineQuote (const QString &text, const int start, int comS
 {
     int index = start;
     bool mixedQuotes = false;
-    if (progLan == "c" || progLan == "cpp"
-        || progLan == "python"
-        /*|| progLan == "sh"*/ // bash uses SH_MultiLineQuote()
-        || progLan == "makefile" || progLan == "cmake"
-        || progLan == "lua" || progLan == "perl"
-        || progLan == "ruby" || progLan == "javascript" || progLan == "scss")
+    if (languageFlags (langId) & hasMixedQuotes) // bash uses SH_MultiLineQuote()
     {
         mixedQuotes = true;
     }
     QRegularExpressionMatch quoteMatch;
     QRegularExpression quoteExpression;
     if (mixedQuotes)
-        quoteExpression.setPattern ("\"|\'");
+        quoteExpression = mixedQuoteExp;
     else
         quoteExpression = quoteMark;
     int quote = doubleQuoteState;
@@ -1963,7 +2665,7 @@ void Highlighter::multiLineQuote (const QString &text, const int start, int comS
                 }
                 else
                 {
-                    quoteExpression.setPattern ("\'");
+                    quoteExpression = singleQuoteExp;
                     quote = singleQuoteState;
                 }
             }
@@ -1979,7 +2681,7 @@ void Highlighter::multiLineQuote (const QString &text, const int start, int comS
             if (quote == doubleQuoteState)
                 quoteExpression = quoteMark;
             else
-                quoteExpression.setPattern ("\'");
+                quoteExpression = singleQuoteExp;
         }
     }
 
@@ -1997,7 +2699,7 @@ void Highlighter::multiLineQuote (const QString &text, const int start, int comS
             }
             else
             {
-                quoteExpression.setPattern ("\'");
+                quoteExpression = singleQuoteExp;
                 quote = singleQuoteState;
             }
         }
@@ -2020,7 +2722,7 @@ void Highlighter::multiLineQuote (const QString &text, const int start, int comS
         bool isQuotation = true;
         if (endIndex == -1)
         {
-            if (progLan == "c" || progLan == "cpp")
+            if (langId == cLanguage || langId == cppLanguage)
             {
                 /* in c and cpp, multiline double quotes need backslash
                    and there's no multiline single quote */
@@ -2030,12 +2732,12 @@ void Highlighter::multiLineQuote (const QString &text, const int start, int comS
                     endIndex = text.size() + 1; // quoteMatch.capturedLength() is -1 here
                 }
             }
-            else if (progLan == "markdown")
+            else if (langId == markdownLanguage)
             { // this is the main differenct of a markdown inline code from a single-line quote
                 isQuotation = false;
             }
         }
-        else if (endIndex == index + 1 && progLan == "markdown")
+        else if (endIndex == index + 1 && langId == markdownLanguage)
         { //  don't format `` because of ``` for code block
             isQuotation = false;
         }
@@ -2069,7 +2771,7 @@ void Highlighter::multiLineQuote (const QString &text, const int start, int comS
 
         /* the next quote may be different */
         if (mixedQuotes)
-            quoteExpression.setPattern ("\"|\'");
+            quoteExpression = mixedQuoteExp;
         index = text.indexOf (quoteExpression, index + quoteLength);
 
         /* skip escaped start quotes and all comments */
@@ -2131,8 +2833,8 @@ void Highlighter::xmlQuotes (const QString &text)
     /* mixed quotes aren't really needed here
        but they're harmless and easy to handle */
     QRegularExpressionMatch quoteMatch;
-    QRegularExpression quoteExpression ("\"|&quot;|\'");
-    QRegularExpression doubleQuote ("\"|&quot;");
+    QRegularExpression quoteExpression = xmlQuoteExp;
+    QRegularExpression doubleQuote = xmlDoubleQuoteExp;
     int quote = doubleQuoteState;
 
     /* find the start quote */
@@ -2159,7 +2861,7 @@ void Highlighter::xmlQuotes (const QString &text)
             }
             else
             {
-                quoteExpression.setPattern ("\'");
+                quoteExpression = singleQuoteExp;
                 quote = singleQuoteState;
             }
         }
@@ -2172,7 +2874,7 @@ void Highlighter::xmlQuotes (const QString &text)
         if (quote == doubleQuoteState)
             quoteExpression = doubleQuote;
         else
-            quoteExpression.setPattern ("\'");
+            quoteExpression = singleQuoteExp;
     }
 
     while (index >= 0)
@@ -2189,7 +2891,7 @@ void Highlighter::xmlQuotes (const QString &text)
             }
             else
             {
-                quoteExpression.setPattern ("\'");
+                quoteExpression = singleQuoteExp;
                 quote = singleQuoteState;
             }
         }
@@ -2227,7 +2929,7 @@ void Highlighter::xmlQuotes (const QString &text)
         }
 
         /* the next quote may be different */
-        quoteExpression.setPattern ("\"|&quot;|\'");
+        quoteExpression = xmlQuoteExp;
         index = text.indexOf (quoteExpression, index + quoteLength);
 
         /* skip all values */
@@ -2239,6 +2941,14 @@ void Highlighter::xmlQuotes (const QString &text)
     }
 }
 /*************************/
+const QRegularExpression &Highlighter::hereDocEndExp (const QString &delimStr)
+{
+    QHash<QString, QRegularExpression>::iterator it = hereDocEndExps.find (delimStr);
+    if (it == hereDocEndExps.end())
+        it = hereDocEndExps.insert (delimStr, precompiled ("\\s*" + delimStr + "(?=(\\W+|$))"));
+    return it.value();
+}
+/*************************/
 // Check if the current block is inside a "here document" and format it accordingly.
 // (Open quotes aren't taken into account when they happen after the start delimiter.)
 bool Highlighter::isHereDocument (const QString &text)
@@ -2255,19 +2965,19 @@ bool Highlighter::isHereDocument (const QString &text)
     QString delimStr;
     /* Kate uses something like "<<(?:\\s*)([\\\\]{0,1}[^\\s]+)" */
     QRegularExpression delim;
-    if (progLan == "sh" || progLan == "makefile" || progLan == "cmake")
-        delim.setPattern ("<<(?:\\s*)(\\\\{0,1}[A-Za-z0-9_]+)|<<(?:\\s*)(\'[A-Za-z0-9_]+\')|<<(?:\\s*)(\"[A-Za-z0-9_]+\")");
-    else if (progLan == "perl") // without space after "<<" and with ";" at the end
-        delim.setPattern ("<<([A-Za-z0-9_]+)(?:;)|<<(\'[A-Za-z0-9_]+\')(?:;)|<<(\"[A-Za-z0-9_]+\")(?:;)");
-    else if (progLan == "ruby")
-        delim.setPattern ("<<(?:-|~){0,1}([A-Za-z0-9_]+)|<<(\'[A-Za-z0-9_]+\')|<<(\"[A-Za-z0-9_]+\")");
+    if (langId == shLanguage || langId == makefileLanguage || langId == cmakeLanguage)
+        delim = shHereDocExp;
+    else if (langId == perlLanguage) // without space after "<<" and with ";" at the end
+        delim = perlHereDocExp;
+    else if (langId == rubyLanguage)
+        delim = rubyHereDocExp;
     else // FIXME: No language.
-        delim.setPattern ("<<([A-Za-z0-9_]+)|<<(\'[A-Za-z0-9_]+\')|<<(\"[A-Za-z0-9_]+\")");
+        delim = cppHereDocExp;
     QRegularExpression comment;
-    if (progLan == "sh" || progLan == "makefile" || progLan == "cmake")
-        comment.setPattern ("^#.*|\\s+#.*");
+    if (langId == shLanguage || langId == makefileLanguage || langId == cmakeLanguage)
+        comment = shCommentExp;
     else
-        comment.setPattern ("#.*");
+        comment = hashCommentExp;
     int insideCommentPos = text.indexOf (comment);
     int pos = 0;
 
@@ -2328,16 +3038,15 @@ bool Highlighter::isHereDocument (const QString &text)
         if (!prevData) return false;
         delimStr = prevData->labelInfo();
         int l = 0;
-        if (progLan == "perl" || progLan == "ruby")
+        if (langId == perlLanguage || langId == rubyLanguage)
         {
             QRegularExpressionMatch rMatch;
-            QRegularExpression r ("\\s*" + delimStr + "(?=(\\W+|$))");
-            if (text.indexOf (r, 0, &rMatch) == 0)
+            if (text.indexOf (hereDocEndExp (delimStr), 0, &rMatch) == 0)
                 l = rMatch.capturedLength();
         }
         else if (text == delimStr
                  || (text.startsWith (delimStr)
-                     && text.indexOf (QRegularExpression ("\\W+")) == delimStr.length()))
+                     && text.indexOf (nonWordExp) == delimStr.length()))
         {
             l = delimStr.length();
         }
@@ -2362,7 +3071,7 @@ bool Highlighter::isHereDocument (const QString &text)
                 if (N > 0)
                 {
                     data->insertNestInfo (N);
-                    QSet<int> Q = prevData->openQuotes();
+                    const QVector<int> &Q = prevData->openQuotes();
                     if (!Q.isEmpty())
                         data->insertOpenQuotes (Q);
                 }
@@ -2413,16 +3122,16 @@ void Highlighter::markDownFonts (const QString &text)
              It also seems that five successive asterisks are ignored at start. */
 
     QRegularExpressionMatch italicMatch;
-    const QRegularExpression italicExp ("(?<!\\\\|\\*{4})\\*([^*]|(?:(?<!\\*)\\*\\*))+\\*|(?<!\\\\|_{4})_([^_]|(?:(?<!_)__))+_"); // allow double asterisks inside
+    static const QRegularExpression italicExp = precompiled ("(?<!\\\\|\\*{4})\\*([^*]|(?:(?<!\\*)\\*\\*))+\\*|(?<!\\\\|_{4})_([^_]|(?:(?<!_)__))+_"); // allow double asterisks inside
 
     QRegularExpressionMatch boldcMatch;
     //const QRegularExpression boldExp ("\\*\\*(?!\\*)(?:(?!\\*\\*).)+\\*\\*|__(?:(?!__).)+__}");
-    const QRegularExpression boldExp ("(?<!\\\\|\\*{3})\\*\\*([^*]|(?:(?<!\\*)\\*))+\\*\\*|(?<!\\\\|_{3})__([^_]|(?:(?<!_)_))+__"); // allow single asterisks inside
+    static const QRegularExpression boldExp = precompiled ("(?<!\\\\|\\*{3})\\*\\*([^*]|(?:(?<!\\*)\\*))+\\*\\*|(?<!\\\\|_{3})__([^_]|(?:(?<!_)_))+__"); // allow single asterisks inside
 
-    const QRegularExpression boldItalicExp ("(?<!\\\\|\\*{2})\\*{3}([^*]|(?:(?<!\\*)\\*))+\\*{3}|(?<!\\\\|_{2})_{3}([^_]|(?:(?<!_)_))+_{3}");
+    static const QRegularExpression boldItalicExp = precompiled ("(?<!\\\\|\\*{2})\\*{3}([^*]|(?:(?<!\\*)\\*))+\\*{3}|(?<!\\\\|_{2})_{3}([^_]|(?:(?<!_)_))+_{3}");
 
     QRegularExpressionMatch expMatch;
-    const QRegularExpression exp (boldExp.pattern() + "|" + italicExp.pattern() + "|" + boldItalicExp.pattern());
+    static const QRegularExpression exp = precompiled (boldExp.pattern() + "|" + italicExp.pattern() + "|" + boldItalicExp.pattern());
 
     int index = 0;
     while ((index = text.indexOf (exp, index, &expMatch)) > -1)
@@ -2472,10 +3181,10 @@ void Highlighter::debControlFormatting (const QString &text)
     QRegularExpression exp;
     int indx = 0;
     QTextCharFormat debFormat;
-    if (text.indexOf (QRegularExpression ("^[^\\s:]+:(?=\\s*)")) == 0)
+    if (text.indexOf (debFieldExp) == 0)
     {
         formatFurther = true;
-        exp.setPattern ("^[^\\s:]+(?=:)");
+        exp = debFieldNameExp;
         if (text.indexOf (exp, 0, &expMatch) == 0)
         {
             /* before ":" */
@@ -2498,7 +3207,7 @@ void Highlighter::debControlFormatting (const QString &text)
             }
         }
     }
-    else if (text.indexOf (QRegularExpression ("^\\s+")) == 0)
+    else if (text.indexOf (leadingSpaceExp) == 0)
     {
         formatFurther = true;
         debFormat.setForeground (DarkGreenAlt);
@@ -2508,7 +3217,7 @@ void Highlighter::debControlFormatting (const QString &text)
     if (formatFurther)
     {
         /* parentheses and brackets */
-        exp.setPattern ("\\([^\\(\\)\\[\\]]+\\)|\\[[^\\(\\)\\[\\]]+\\]");
+        exp = debParenExp;
         int index = indx;
         debFormat = neutralFormat;
         debFormat.setFontItalic (true);
@@ -2520,7 +3229,7 @@ void Highlighter::debControlFormatting (const QString &text)
             {
                 setFormat (index + 1, ml - 2 , debFormat);
 
-                QRegularExpression rel ("<|>|\\=|~");
+                QRegularExpression rel = debRelationExp;
                 int i = index;
                 while ((i = text.indexOf (rel, i)) > -1 && i < index + ml - 1)
                 {
@@ -2555,8 +3264,11 @@ void Highlighter::highlightBlock (const QString &text)
        This is also safe when the paragraph separators are hidden. */
     setFormat(0, text.size(), mainFormat);
 
+    /* the end state of this block before it's re-highlighted (the checkpoint) */
+    const int oldState = currentBlockState();
+
     bool rehighlightNextBlock = false;
-    int oldOpenNests = 0; QSet<int> oldOpenQuotes; // to be used in SH_CmndSubstVar()
+    int oldOpenNests = 0; QVector<int> oldOpenQuotes; // to be used in SH_CmndSubstVar()
     if (TextBlockData *oldData = static_cast<TextBlockData *>(currentBlockUserData()))
     {
         oldOpenNests = oldData->openNests();
@@ -2568,13 +3280,13 @@ void Highlighter::highlightBlock (const QString &text)
     data->insertHighlightInfo (false); // not highlighted yet
     setCurrentBlockUserData (data); // to be fed in later
     setCurrentBlockState (0);
+    invalidateBracketChunk (currentBlock().blockNumber());
 
     /********************
      * "Here" Documents *
      ********************/
 
-    if (progLan == "sh" || progLan == "makefile" || progLan == "cmake"
-        || progLan == "perl" || progLan == "ruby")
+    if (lexerStages & hereDocStage)
     {
         if (isHereDocument (text))
         {
@@ -2590,27 +3302,28 @@ void Highlighter::highlightBlock (const QString &text)
                         if (nextData->openQuotes() != data->openQuotes()
                             || (nextBlock.userState() >= 0 && nextBlock.userState() < endState)) // end delimiter
                         {
-                            QMetaObject::invokeMethod (this, "rehighlightBlock", Qt::QueuedConnection, Q_ARG (QTextBlock, nextBlock));
+                            rehighlightLater (nextBlock);
                         }
                     }
                 }
             }
+            deferCascade (oldState, oldOpenNests, oldOpenQuotes);
             return;
         }
     }
     /* just for debian control file */
-    else if (progLan == "deb")
+    else if (lexerStages & debControlStage)
         debControlFormatting (text);
 
     int bn = currentBlock().blockNumber();
-    bool mainFormatting (bn >= startCursor.blockNumber() && bn <= endCursor.blockNumber());
+    bool mainFormatting (isMainFormatting (bn));
     QTextCharFormat fi;
 
     /************************
      * Single-Line Comments *
      ************************/
 
-    if (progLan != "html")
+    if (lexerStages & singleLineCommentStage)
         singleLineComment (text, 0);
 
     /* this is only for setting the format of
@@ -2627,26 +3340,20 @@ void Highlighter::highlightBlock (const QString &text)
      * XML Quotations and Comments *
      *******************************/
 
-    if (progLan == "xml")
+    if (lexerStages & xmlQuoteStage)
     {
         /* value is handled as a kind of comment */
-        multiLineComment (text, 0, -1, QRegularExpression ("(>|&gt;)"), QRegularExpression ("(<|&lt;)"), xmlValueState, neutralFormat);
+        multiLineComment (text, 0, -1, xmlValueStartExp, xmlValueEndExp, xmlValueState, neutralFormat);
         /* multiline quotes as signs of errors in the xml doc */
         xmlQuotes (text);
     }
     /**************************
      * (Multiline) Quotations *
      **************************/
-    else if (progLan == "sh") // bash has its own method
+    else if (lexerStages & shQuoteStage) // bash has its own method
         SH_MultiLineQuote (text);
-    else if (progLan != "diff" && progLan != "log"
-             && progLan != "desktop" && progLan != "config" && progLan != "theme"
-             && progLan != "changelog" && progLan != "url"
-             && progLan != "srt" && progLan != "html"
-             && progLan != "deb" && progLan != "m3u")
-    {
+    else if (lexerStages & quoteStage)
         multiLineQuote (text);
-    }
 
     /*******
      * CSS *
@@ -2659,7 +3366,7 @@ void Highlighter::highlightBlock (const QString &text)
      * Multiline Comments *
      **********************/
 
-    if (!commentStartExpression.pattern().isEmpty() && progLan != "python")
+    if (lexerStages & multiLineCommentStage)
         multiLineComment (text, 0, cssIndx, commentStartExpression, commentEndExpression, commentState, commentFormat);
 
     /* only javascript, for now */
@@ -2669,17 +3376,17 @@ void Highlighter::highlightBlock (const QString &text)
      * Markdown *
      ************/
 
-    if (progLan == "markdown" && blockQuoteFormat.isValid() && codeBlockFormat.isValid())
+    if ((lexerStages & markdownStage) && blockQuoteFormat.isValid() && codeBlockFormat.isValid())
     {
         int prevState = previousBlockState();
         /* the block quote of markdown is like a multiline comment
            but shouldn't be formatted inside a real comment */
         if (prevState != commentState)
-            multiLineComment (text, 0, -1, QRegularExpression ("^>.*"), QRegularExpression ("^$"), markdownBlockQuoteState, blockQuoteFormat);
+            multiLineComment (text, 0, -1, mdBlockQuoteStartExp, emptyLineExp, markdownBlockQuoteState, blockQuoteFormat);
         /* the ``` code block of markdown is like a multiline comment
            but shouldn't be formatted inside a comment or block quote */
         if (prevState != commentState && prevState != markdownBlockQuoteState)
-            multiLineComment (text, 0, -1, QRegularExpression ("^```[^\\s`]*$"), QRegularExpression ("^```$"), markdownCodeBlockState, codeBlockFormat);
+            multiLineComment (text, 0, -1, mdCodeBlockStartExp, mdCodeBlockEndExp, markdownCodeBlockState, codeBlockFormat);
         if (mainFormatting)
         {
             data->insertHighlightInfo (true); // completely highlighted
@@ -2724,7 +3431,7 @@ void Highlighter::highlightBlock (const QString &text)
      * HTML Only *
      *************/
 
-    else if (progLan == "html")
+    else if (lexerStages & htmlStage)
     {
         htmlBrackets (text);
         htmlCSSHighlighter (text);
@@ -2740,64 +3447,17 @@ void Highlighter::highlightBlock (const QString &text)
     else if (mainFormatting)
     {
         data->insertHighlightInfo (true); // completely highlighted
-        for (const HighlightingRule &rule : static_cast<const QVector<HighlightingRule>&>(highlightingRules))
+        /* the format runs may have been found in the worker thread */
+        QHash<QString, QVector<FormatRun> >::const_iterator it = tokenCache.constFind (text);
+        if (it != tokenCache.constEnd())
+            applyFormatRuns (it.value());
+        else
         {
-            /* single-line comments are already formatted */
-            if (rule.format == commentFormat)
-                continue;
-
-            QRegularExpressionMatch match;
-            index = text.indexOf (rule.pattern, 0, &match);
-            /* skip quotes and all comments */
-            if (rule.format != whiteSpaceFormat)
-            {
-                fi = format (index);
-                while (index >= 0
-                       && (fi == quoteFormat || fi == altQuoteFormat || fi == urlInsideQuoteFormat
-                           || fi == commentFormat || fi == urlFormat
-                           || fi == JSRegexFormat))
-                {
-                    index = text.indexOf (rule.pattern, index + match.capturedLength(), &match);
-                    fi = format (index);
-                }
-            }
-
-            while (index >= 0)
-            {
-                int length = match.capturedLength();
-                int l = length;
-                /* In c/c++, the neutral pattern after "#define" may contain
-                   a (double-)slash but it's always good to check whether a
-                   part of the match is inside an already formatted region. */
-                if (rule.format != whiteSpaceFormat)
-                {
-                    while (format (index + l - 1) == commentFormat
-                           /*|| format (index + l - 1) == commentFormat
-                           || format (index + l - 1) == urlFormat
-                           || format (index + l - 1) == quoteFormat
-                           || format (index + l - 1) == altQuoteFormat
-                           || format (index + l - 1) == urlInsideQuoteFormat
-                           || format (index + l - 1) == JSRegexFormat*/)
-                    {
-                        -- l;
-                    }
-                }
-                setFormat (index, l, rule.format);
-                index = text.indexOf (rule.pattern, index + length, &match);
-
-                if (rule.format != whiteSpaceFormat)
-                {
-                    fi = format (index);
-                    while (index >= 0
-                           && (fi == quoteFormat || fi == altQuoteFormat || fi == urlInsideQuoteFormat
-                               || fi == commentFormat || fi == urlFormat
-                               || fi == JSRegexFormat))
-                    {
-                        index = text.indexOf (rule.pattern, index + match.capturedLength(), &match);
-                        fi = format (index);
-                    }
-                }
-            }
+            QVector<FormatRun> runs = formatRuns (text, mainRules);
+            applyFormatRuns (runs);
+            if (tokenCache.size() >= MAX_CACHED_TEXTS)
+                tokenCache.clear();
+            tokenCache.insert (text, runs);
         }
     }
 
@@ -2812,17 +3472,14 @@ void Highlighter::highlightBlock (const QString &text)
            && (fi == quoteFormat || fi == altQuoteFormat || fi == urlInsideQuoteFormat
                || fi == commentFormat || fi == urlFormat
                || fi == JSRegexFormat
-               || (progLan == "sh" && isEscapedChar (text, index))))
+               || ((lexerStages & escapedBracketStage) && isEscapedChar (text, index))))
     {
         index = text.indexOf ('(', index + 1);
         fi = format (index);
     }
     while (index >= 0)
     {
-        ParenthesisInfo *info = new ParenthesisInfo;
-        info->character = '(';
-        info->position = index;
-        data->insertInfo (info);
+        data->insertInfo ('(', index);
 
         index = text.indexOf ('(', index + 1);
         fi = format (index);
@@ -2830,7 +3487,7 @@ void Highlighter::highlightBlock (const QString &text)
                && (fi == quoteFormat || fi == altQuoteFormat || fi == urlInsideQuoteFormat
                    || fi == commentFormat || fi == urlFormat
                    || fi == JSRegexFormat
-                   || (progLan == "sh" && isEscapedChar (text, index))))
+                   || ((lexerStages & escapedBracketStage) && isEscapedChar (text, index))))
         {
             index = text.indexOf ('(', index + 1);
             fi = format (index);
@@ -2844,17 +3501,14 @@ void Highlighter::highlightBlock (const QString &text)
            && (fi == quoteFormat || fi == altQuoteFormat || fi == urlInsideQuoteFormat
                || fi == commentFormat || fi == urlFormat
                || fi == JSRegexFormat
-               || (progLan == "sh" && isEscapedChar (text, index))))
+               || ((lexerStages & escapedBracketStage) && isEscapedChar (text, index))))
     {
         index = text.indexOf (')', index + 1);
         fi = format (index);
     }
     while (index >= 0)
     {
-        ParenthesisInfo *info = new ParenthesisInfo;
-        info->character = ')';
-        info->position = index;
-        data->insertInfo (info);
+        data->insertInfo (')', index);
 
         index = text.indexOf (')', index +1);
         fi = format (index);
@@ -2862,7 +3516,7 @@ void Highlighter::highlightBlock (const QString &text)
                && (fi == quoteFormat || fi == altQuoteFormat || fi == urlInsideQuoteFormat
                    || fi == commentFormat || fi == urlFormat
                    || fi == JSRegexFormat
-                   || (progLan == "sh" && isEscapedChar (text, index))))
+                   || ((lexerStages & escapedBracketStage) && isEscapedChar (text, index))))
         {
             index = text.indexOf (')', index + 1);
             fi = format (index);
@@ -2882,10 +3536,7 @@ void Highlighter::highlightBlock (const QString &text)
     }
     while (index >= 0)
     {
-        BraceInfo *info = new BraceInfo;
-        info->character = '{';
-        info->position = index;
-        data->insertInfo (info);
+        data->insertInfo ('{', index);
 
         index = text.indexOf ('{', index + 1);
         fi = format (index);
@@ -2912,10 +3563,7 @@ void Highlighter::highlightBlock (const QString &text)
     }
     while (index >= 0)
     {
-        BraceInfo *info = new BraceInfo;
-        info->character = '}';
-        info->position = index;
-        data->insertInfo (info);
+        data->insertInfo ('}', index);
 
         index = text.indexOf ('}', index +1);
         fi = format (index);
@@ -2936,17 +3584,14 @@ void Highlighter::highlightBlock (const QString &text)
            && (fi == quoteFormat || fi == altQuoteFormat || fi == urlInsideQuoteFormat
                || fi == commentFormat || fi == urlFormat
                || fi == JSRegexFormat
-               || (progLan == "sh" && isEscapedChar (text, index))))
+               || ((lexerStages & escapedBracketStage) && isEscapedChar (text, index))))
     {
         index = text.indexOf ('[', index + 1);
         fi = format (index);
     }
     while (index >= 0)
     {
-        BracketInfo *info = new BracketInfo;
-        info->character = '[';
-        info->position = index;
-        data->insertInfo (info);
+        data->insertInfo ('[', index);
 
         index = text.indexOf ('[', index + 1);
         fi = format (index);
@@ -2954,7 +3599,7 @@ void Highlighter::highlightBlock (const QString &text)
                && (fi == quoteFormat || fi == altQuoteFormat || fi == urlInsideQuoteFormat
                    || fi == commentFormat || fi == urlFormat
                    || fi == JSRegexFormat
-                   || (progLan == "sh" && isEscapedChar (text, index))))
+                   || ((lexerStages & escapedBracketStage) && isEscapedChar (text, index))))
         {
             index = text.indexOf ('[', index + 1);
             fi = format (index);
@@ -2968,17 +3613,14 @@ void Highlighter::highlightBlock (const QString &text)
            && (fi == quoteFormat || fi == altQuoteFormat || fi == urlInsideQuoteFormat
                || fi == commentFormat || fi == urlFormat
                || fi == JSRegexFormat
-               || (progLan == "sh" && isEscapedChar (text, index))))
+               || ((lexerStages & escapedBracketStage) && isEscapedChar (text, index))))
     {
         index = text.indexOf (']', index + 1);
         fi = format (index);
     }
     while (index >= 0)
     {
-        BracketInfo *info = new BracketInfo;
-        info->character = ']';
-        info->position = index;
-        data->insertInfo (info);
+        data->insertInfo (']', index);
 
         index = text.indexOf (']', index +1);
         fi = format (index);
@@ -2986,7 +3628,7 @@ void Highlighter::highlightBlock (const QString &text)
                && (fi == quoteFormat || fi == altQuoteFormat || fi == urlInsideQuoteFormat
                    || fi == commentFormat || fi == urlFormat
                    || fi == JSRegexFormat
-                   || (progLan == "sh" && isEscapedChar (text, index))))
+                   || ((lexerStages & escapedBracketStage) && isEscapedChar (text, index))))
         {
             index = text.indexOf (']', index + 1);
             fi = format (index);
@@ -2999,8 +3641,10 @@ void Highlighter::highlightBlock (const QString &text)
     {
         QTextBlock nextBlock = currentBlock().next();
         if (nextBlock.isValid())
-            QMetaObject::invokeMethod (this, "rehighlightBlock", Qt::QueuedConnection, Q_ARG (QTextBlock, nextBlock));
+            rehighlightLater (nextBlock);
     }
+
+    deferCascade (oldState, oldOpenNests, oldOpenQuotes);
 }
 
 }
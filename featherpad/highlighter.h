@@ -22,25 +22,36 @@
 
 #include <QSyntaxHighlighter>
 #include <QRegularExpression>
+#include <QHash>
+#include <QVarLengthArray>
+#include <QTextCursor>
+#include <QElapsedTimer>
+#include <QTimer>
+#include "languages.h"
+#include "regexps.h"
 
 namespace FeatherPad {
 
-struct ParenthesisInfo
+enum BracketKind
 {
-    char character; // '(' or ')'
-    int position;
+    parenthesisKind = 0,
+    braceKind,
+    squareBracketKind
 };
 
-struct BraceInfo
+struct BracketInfo
 {
-    char character; // '{' or '}'
+    char kind; // A BracketKind.
+    char character; // '(', ')', '{', '}', '[' or ']'
     int position;
 };
 
-struct BracketInfo
+/* The nesting depths of the brackets of a kind in a text range: */
+struct BracketDepths
 {
-    char character; // '[' or ']'
-    int position;
+    int delta; // The number of opening brackets minus that of closing ones.
+    int minPrefix; // The minimum depth from the start (<= 0).
+    int maxSuffix; // The maximum depth change of the range ends (>= 0).
 };
 
 
@@ -49,42 +60,49 @@ struct BracketInfo
 class TextBlockData : public QTextBlockUserData
 {
 public:
-    TextBlockData() { Highlighted = false; Property = false; OpenNests = 0; }
-    ~TextBlockData();
-    QVector<ParenthesisInfo *> parentheses() const;
-    QVector<BraceInfo *> braces() const;
-    QVector<BracketInfo *> brackets() const;
+    TextBlockData() {
+        Highlighted = false; Property = false; OpenNests = 0;
+        BracketCounts[parenthesisKind] = BracketCounts[braceKind] = BracketCounts[squareBracketKind] = 0;
+    }
+    int bracketCount (BracketKind kind) const;
+    const BracketInfo &bracketAt (BracketKind kind, int i) const;
+    BracketDepths bracketDepths (BracketKind kind) const;
     QString labelInfo() const;
     bool isHighlighted() const;
     bool getProperty() const;
     int openNests() const;
-    QSet<int> openQuotes() const;
-    void insertInfo (ParenthesisInfo *info);
-    void insertInfo (BraceInfo *info);
-    void insertInfo (BracketInfo *info);
+    const QVector<int> &openQuotes() const;
+    bool hasOpenQuote (int nest) const;
+    void insertInfo (char character, int position);
     void insertInfo (const QString &str);
     void insertHighlightInfo (bool highlighted);
     void setProperty (bool p);
     void insertNestInfo (int nests);
-    void insertOpenQuotes (const QSet<int> &openQuotes);
+    void insertOpenQuotes (const QVector<int> &openQuotes);
 
 private:
-    QVector<ParenthesisInfo *> allParentheses;
-    QVector<BraceInfo *> allBraces;
-    QVector<BracketInfo *> allBrackets;
+    int firstBracket (BracketKind kind) const;
+    /* All parentheses, braces and square brackets, sorted by their kinds and then
+       by their positions. Most blocks have only a few of them, which are stored
+       inside the block data without any heap allocation. */
+    QVarLengthArray<BracketInfo, 4> allBrackets;
+    int BracketCounts[3]; // The number of brackets of each kind.
     QString label; // A label (usually, the delimiter string of a here-doc).
     bool Highlighted; // Is this block completely highlighted?
     bool Property; // A general boolean property (use with SH).
     /* "Nest" is a generalized bracket. This variable
        is the number of unclosed nests in a block. */
     int OpenNests;
-    QSet<int> OpenQuotes; // The numbers of open double quotes of open nests.
+    QVector<int> OpenQuotes; // The sorted numbers of open double quotes of open nests.
 };
 /*************************/
+class Tokenizer;
+
 /* This is a tricky but effective way for syntax highlighting. */
 class Highlighter : public QSyntaxHighlighter
 {
     Q_OBJECT
+    friend class Tokenizer;
 
 public:
     Highlighter (QTextDocument *parent, const QString& lang,
@@ -98,10 +116,43 @@ public:
         endCursor = end;
     }
 
+    void tokenizeAround (const QTextBlock &start, const QTextBlock &end);
+
+    int matchingBracket (const QTextBlock &block, BracketKind kind, int index, bool forward);
+
+    /* The stages of highlightBlock() that a language needs (see highlighter-lexer.cpp): */
+    enum LexerStage
+    {
+        hereDocStage = 0x1,
+        debControlStage = 0x2,
+        singleLineCommentStage = 0x4,
+        quoteStage = 0x8, // multiLineQuote()
+        shQuoteStage = 0x10,
+        xmlQuoteStage = 0x20,
+        multiLineCommentStage = 0x40,
+        markdownStage = 0x80,
+        htmlStage = 0x100,
+        escapedBracketStage = 0x200 // brackets can be escaped by backslashes
+    };
+
 protected:
     void highlightBlock (const QString &text);
 
+private slots:
+    void onTokenized();
+    void rehighlightDeferred();
+    void highlightIdle();
+    void onContentsChange (int pos);
+
 private:
+    struct Lexer
+    {
+        int stages; // A combination of LexerStage flags.
+        QRegularExpression commentStart;
+        QRegularExpression commentEnd;
+    };
+    static Lexer lexer (Language lang);
+
     QStringList keywords (const QString &lang);
     QStringList types();
     bool isEscapedChar (const QString &text, const int pos);
@@ -135,11 +186,11 @@ private:
     void SH_MultiLineQuote(const QString &text);
     bool SH_SkipQuote (const QString &text, const int pos, bool isStartQuote);
     int formatInsideCommand (const QString &text,
-                             const int minOpenNests, int &nests, QSet<int> &quotes,
+                             const int minOpenNests, int &nests, QVector<int> &quotes,
                              const bool isHereDocStart, const int index);
     bool SH_CmndSubstVar (const QString &text,
                           TextBlockData *currentBlockData,
-                          int oldOpenNests, const QSet<int> &oldOpenQuotes);
+                          int oldOpenNests, const QVector<int> &oldOpenQuotes);
 
     void markDownFonts (const QString &text);
     void debControlFormatting (const QString &text);
@@ -152,8 +203,74 @@ private:
     {
         QRegularExpression pattern;
         QTextCharFormat format;
+        /* A keyword rule has no pattern but a sorted list of keywords
+           and the characters that shouldn't come after a keyword. */
+        QStringList keywords;
+        QString excluded;
     };
     QVector<HighlightingRule> highlightingRules;
+    /* The same as highlightingRules but with the simple keyword patterns
+       converted to keyword rules. It's used by the main formatting. */
+    QVector<HighlightingRule> mainRules;
+
+    QVector<HighlightingRule> keywordRules (const QVector<HighlightingRule> &rules) const;
+
+    /* The main formatting is done in two steps: first, the matches of the main rules
+       are found (in a worker thread if possible); then, they're formatted if they
+       aren't inside quotes or comments. The first step doesn't depend on formats. */
+    struct FormatRun
+    {
+        int start;
+        int length;
+        int rule; // The index of the rule in mainRules.
+    };
+    static QVector<FormatRun> formatRuns (const QString &text, const QVector<HighlightingRule> &rules);
+    void applyFormatRuns (const QVector<FormatRun> &runs);
+    QHash<QString, QVector<FormatRun> > tokenCache; // The format runs of block texts.
+    Tokenizer *tokenizer; // The worker thread.
+    bool tokenizingPending;
+
+    /* The end state of a block (its state, open nests and open quotes) is its checkpoint.
+       After an edit, the next blocks are re-highlighted until the state converges with
+       the checkpoint but off-screen blocks are deferred if that takes too long. */
+    void rehighlightLater (const QTextBlock &block);
+    void deferCascade (int oldState, int oldOpenNests, const QVector<int> &oldOpenQuotes);
+    QList<QTextCursor> deferredCursors; // The blocks to be re-highlighted later, in order.
+    QTimer *deferTimer;
+    QElapsedTimer cascadeTimer;
+    int lastHighlighted; // The number of the last highlighted block.
+    bool initialPass; // Whether the document is being highlighted for the first time.
+    bool deferring; // Whether deferred blocks are being re-highlighted.
+
+    /* The blocks that aren't visible are completely highlighted
+       in small time slices when the event loop is idle. */
+    bool isMainFormatting (int bn) const {
+        return idleFormatting || (bn >= startCursor.blockNumber() && bn <= endCursor.blockNumber());
+    }
+    QTextCursor idleCursor; // The block from which the idle highlighting continues.
+    QTimer *idleTimer;
+    int lastRevision; // The document revision, to distinguish edits from format changes.
+    bool idleFormatting; // Whether a block is being highlighted at an idle time.
+
+    /* The bracket index: the nesting depths of the blocks are summarized
+       for chunks of blocks, so that brackets are matched by skipping
+       the chunks that can't contain the match. Chunks are invalidated
+       when their blocks are highlighted or the block count changes. */
+    BracketDepths chunkDepths (int chunk, BracketKind kind);
+    void invalidateBracketChunk (int bn);
+    QVector<BracketDepths> bracketChunks; // Three items per chunk.
+    int lastBlockCount;
+
+    /* The expressions that find the ends of Perl and Ruby here-docs, which
+       depend on their delimiters, are compiled once for each delimiter. */
+    const QRegularExpression &hereDocEndExp (const QString &delimStr);
+    QHash<QString, QRegularExpression> hereDocEndExps;
+
+    /* The precompiled expressions that are used in more than one source file
+       (the others are static variables of the files; see "regexps.h"). */
+    static const QRegularExpression mixedQuoteExp;
+    static const QRegularExpression singleQuoteExp;
+    static const QRegularExpression shHereDocExp;
 
     /* Multiline comments: */
     QRegularExpression commentStartExpression;
@@ -174,6 +291,8 @@ private:
 
     /* Programming language: */
     QString progLan;
+    Language langId; // The ID of progLan, to be compared instead of it.
+    int lexerStages; // The LexerStage flags of the language.
 
     QRegularExpression quoteMark;
     QColor Blue, DarkBlue, Red, DarkRed, Verda, DarkGreen, DarkGreenAlt, DarkMagenta, Violet, Brown, DarkYellow;
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#include "languages.h"
+#include <QHash>
+
+namespace FeatherPad {
+
+static const struct LanguageRow
+{
+    const char *name;
+    Language id;
+    int flags;
+} languageRows[] =
+{
+    {"c", cLanguage, hasMixedQuotes | hasEscapedQuotes},
+    {"cpp", cppLanguage, hasMixedQuotes | hasEscapedQuotes},
+    {"sh", shLanguage, isScript | hasEscapedStartQuotes},
+    {"makefile", makefileLanguage, hasMixedQuotes | hasEscapedStartQuotes},
+    {"cmake", cmakeLanguage, hasMixedQuotes | hasEscapedStartQuotes},
+    {"qmake", qmakeLanguage, 0},
+    {"perl", perlLanguage, isScript | hasMixedQuotes | hasEscapedStartQuotes | hasEscapedQuotes},
+    {"ruby", rubyLanguage, isScript | hasMixedQuotes},
+    {"lua", luaLanguage, isScript | hasMixedQuotes},
+    {"python", pythonLanguage, isScript | hasMixedQuotes | hasEscapedQuotes},
+    {"javascript", javascriptLanguage, hasMixedQuotes | hasEscapedQuotes},
+    {"qml", qmlLanguage, 0},
+    {"php", phpLanguage, 0},
+    {"css", cssLanguage, 0},
+    {"scss", scssLanguage, hasMixedQuotes},
+    {"xml", xmlLanguage, 0},
+    {"html", htmlLanguage, 0},
+    {"markdown", markdownLanguage, hasEscapedStartQuotes | hasEscapedQuotes},
+    {"troff", troffLanguage, 0},
+    {"diff", diffLanguage, 0},
+    {"log", logLanguage, 0},
+    {"desktop", desktopLanguage, 0},
+    {"config", configLanguage, 0},
+    {"theme", themeLanguage, 0},
+    {"changelog", changelogLanguage, 0},
+    {"url", urlLanguage, 0},
+    {"srt", srtLanguage, 0},
+    {"gtkrc", gtkrcLanguage, 0},
+    {"deb", debLanguage, 0},
+    {"m3u", m3uLanguage, 0}
+};
+
+Language languageId (const QString &name)
+{
+    static QHash<QString, Language> ids;
+    if (ids.isEmpty())
+    {
+        for (const LanguageRow &row : languageRows)
+            ids.insert (QString::fromLatin1 (row.name), row.id);
+    }
+    return ids.value (name, noLanguage);
+}
+/*************************/
+int languageFlags (Language lang)
+{
+    static int flags[languageCount] = {0};
+    static bool initialized = false;
+    if (!initialized)
+    {
+        for (const LanguageRow &row : languageRows)
+            flags[row.id] = row.flags;
+        initialized = true;
+    }
+    return flags[lang];
+}
+
+}
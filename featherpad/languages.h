@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#ifndef LANGUAGES_H
+#define LANGUAGES_H
+
+#include <QString>
+
+namespace FeatherPad {
+
+/* The IDs of the languages of syntax highlighting. The names of languages
+   are used in the GUI and configuration but their IDs are compared in the
+   code that runs for each text block. */
+enum Language
+{
+    noLanguage = 0,
+    cLanguage,
+    cppLanguage,
+    shLanguage,
+    makefileLanguage,
+    cmakeLanguage,
+    qmakeLanguage,
+    perlLanguage,
+    rubyLanguage,
+    luaLanguage,
+    pythonLanguage,
+    javascriptLanguage,
+    qmlLanguage,
+    phpLanguage,
+    cssLanguage,
+    scssLanguage,
+    xmlLanguage,
+    htmlLanguage,
+    markdownLanguage,
+    troffLanguage,
+    diffLanguage,
+    logLanguage,
+    desktopLanguage,
+    configLanguage,
+    themeLanguage,
+    changelogLanguage,
+    urlLanguage,
+    srtLanguage,
+    gtkrcLanguage,
+    debLanguage,
+    m3uLanguage,
+    languageCount
+};
+
+/* The capabilities of languages. (Whether a language has here-docs or
+   multiline comments is given by its lexer stages in "highlighter-lexer.cpp".) */
+enum LanguageFlag
+{
+    isScript = 0x1, // can be executed
+    hasMixedQuotes = 0x2, // both single and double quotes are formatted as quotes
+    hasEscapedStartQuotes = 0x4,
+    hasEscapedQuotes = 0x8 // quotes can be escaped by backslashes
+};
+
+Language languageId (const QString &name);
+int languageFlags (Language lang);
+
+}
+
+#endif // LANGUAGES_H
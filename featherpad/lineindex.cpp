@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+
+#include "lineindex.h"
+#include <QString>
+
+namespace FeatherPad {
+
+// Finds the document positions of line starts, knowing that QTextDocument
+// breaks lines at '\n', '\r' and the paragraph separator but takes "\r\n"
+// as a single line break.
+void LineIndex::indexText (const QString& text)
+{
+    charOffsets_.clear();
+    charOffsets_.append (0);
+    const QChar *chars = text.constData();
+    const int n = text.size();
+    int pos = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        ++pos;
+        const ushort c = chars[i].unicode();
+        if (c == '\n' || c == QChar::ParagraphSeparator)
+            charOffsets_.append (pos);
+        else if (c == '\r')
+        {
+            if (i + 1 < n && chars[i + 1] == QLatin1Char ('\n'))
+                ++i;
+            charOffsets_.append (pos);
+        }
+    }
+}
+
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#ifndef LINEINDEX_H
+#define LINEINDEX_H
+
+#include <QVector>
+#include <QMetaType>
+
+namespace FeatherPad {
+
+/* The positions of the starts of lines in the document made of a loaded
+   text, as they are found in the loading thread. Since the vector is
+   implicitly shared, an index is copied cheaply. It becomes useless
+   when the text is edited. */
+class LineIndex
+{
+public:
+    bool isEmpty() const {
+        return charOffsets_.isEmpty();
+    }
+    void clear() {
+        charOffsets_.clear();
+    }
+
+    int lineCount() const {
+        return charOffsets_.size();
+    }
+    /* the position of the start of the line in the document */
+    int position (int line) const {
+        return charOffsets_.at (line);
+    }
+    /* used by the loading thread */
+    void indexText (const QString& text);
+
+private:
+    QVector<int> charOffsets_;
+};
+
+}
+
+Q_DECLARE_METATYPE(FeatherPad::LineIndex)
+
+#endif // LINEINDEX_H
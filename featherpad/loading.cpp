@@ -21,9 +21,152 @@
 #include "encoding.h"
 #include <QFile>
 #include <QTextCodec>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSemaphore>
+#include <string.h> // memchr
 
 namespace FeatherPad {
 
+/* No line may have more than this number of characters. */
+static const int MAX_LINE_LENGTH = 500000;
+/* Larger files are shown page by page. */
+static const qint64 PAGING_SIZE = 100*1024*1024;
+/* The minimum size of the chunks of a text that are decoded in parallel. */
+static const int DECODING_CHUNK_SIZE = 4*1024*1024;
+/* The size of the blocks read when the file can't be mapped into memory. */
+static const qint64 BLOCK_SIZE = 4*1024*1024;
+
+/* Gets all bytes of the file in one go, preferably by mapping it into memory
+   and, otherwise, by reading large blocks into a buffer sized up front. */
+static const char* fileBytes (QFile &file, QByteArray &buffer, qint64 &size)
+{
+    size = file.size();
+    if (size > 0)
+    {
+        if (uchar *map = file.map (0, size))
+            return reinterpret_cast<const char*>(map);
+        buffer.resize (static_cast<int>(size));
+        qint64 total = 0, n;
+        while (total < size
+               && (n = file.read (buffer.data() + total, qMin (BLOCK_SIZE, size - total))) > 0)
+        {
+            total += n;
+        }
+        size = total;
+        buffer.resize (static_cast<int>(size));
+        if (file.atEnd())
+            return buffer.constData();
+    }
+    /* the size may be unknown (as with some special files) or may have changed */
+    QByteArray block;
+    while (!(block = file.read (BLOCK_SIZE)).isEmpty())
+        buffer.append (block);
+    size = buffer.size();
+    return buffer.constData();
+}
+/*************************/
+/* Finds the next line end ('\n' or '\r') in [p, end) by using memchr(),
+   which is vectorized by the C library. The positions of the next '\n'
+   and '\r' are cached so that each byte is scanned only once. */
+static inline const char* nextLineEnd (const char *p, const char *end,
+                                       const char *&nextLF, const char *&nextCR)
+{
+    if (nextLF == nullptr || nextLF < p)
+    {
+        nextLF = static_cast<const char*>(memchr (p, '\n', end - p));
+        if (nextLF == nullptr) nextLF = end;
+    }
+    if (nextCR == nullptr || nextCR < p)
+    {
+        nextCR = static_cast<const char*>(memchr (p, '\r', end - p));
+        if (nextCR == nullptr) nextCR = end;
+    }
+    return qMin (nextLF, nextCR);
+}
+/*************************/
+/* Only these encodings can be decoded in independent chunks. */
+static bool isStateless (QTextCodec *codec)
+{
+    const QByteArray name = codec->name();
+    return name == "UTF-8" || name == "US-ASCII"
+           || name.startsWith ("ISO-8859-")
+           || name.startsWith ("windows-125")
+           || name.startsWith ("KOI8-");
+}
+/*************************/
+class DecodingTask : public QRunnable
+{
+public:
+    DecodingTask (QTextCodec *codec, const char *bytes, int size, QString *result, QSemaphore *done) :
+        codec_ (codec), bytes_ (bytes), size_ (size), result_ (result), done_ (done) {}
+
+    void run() {
+        /* a chunk in the middle doesn't start with a byte order mark */
+        QTextCodec::ConverterState state (QTextCodec::IgnoreHeader);
+        *result_ = codec_->toUnicode (bytes_, size_, &state);
+        done_->release();
+    }
+
+private:
+    QTextCodec *codec_;
+    const char *bytes_;
+    int size_;
+    QString *result_;
+    QSemaphore *done_;
+};
+/*************************/
+/* Decodes a large text in chunks, which are split at line breaks
+   and decoded in the global thread pool, if the encoding allows it. */
+static QString decode (QTextCodec *codec, const QByteArray& data)
+{
+    const int size = data.size();
+    const int n = qMin (QThread::idealThreadCount(), size / DECODING_CHUNK_SIZE);
+    if (n < 2 || !isStateless (codec))
+        return codec->toUnicode (data);
+
+    const char *start = data.constData();
+    const char *end = start + size;
+    QVector<const char*> bounds;
+    bounds << start;
+    for (int i = 1; i < n; ++i)
+    {
+        const char *p = start + static_cast<qint64>(size) * i / n;
+        if (p <= bounds.last()) continue;
+        p = static_cast<const char*>(memchr (p, '\n', end - p));
+        if (p == nullptr || p + 1 >= end) break;
+        bounds << p + 1;
+    }
+    bounds << end;
+    const int chunks = bounds.size() - 1;
+
+    QVector<QString> parts (chunks);
+    QString *results = parts.data();
+    QSemaphore done;
+    QThreadPool *pool = QThreadPool::globalInstance();
+    for (int i = 1; i < chunks; ++i)
+    {
+        pool->start (new DecodingTask (codec, bounds.at (i),
+                                       static_cast<int>(bounds.at (i + 1) - bounds.at (i)),
+                                       results + i, &done));
+    }
+    /* the first chunk is decoded here, with its byte order mark */
+    results[0] = codec->toUnicode (start, static_cast<int>(bounds.at (1) - start));
+    done.acquire (chunks - 1);
+
+    int length = 0;
+    for (int i = 0; i < chunks; ++i)
+        length += results[i].size();
+    QString text;
+    text.reserve (length);
+    for (int i = 0; i < chunks; ++i)
+    {
+        text += results[i];
+        results[i] = QString();
+    }
+    return text;
+}
+/*************************/
 Loading::Loading (const QString& fname, const QString& charset, bool reload,
                   bool saveCursor, bool forceUneditable, bool multiple) :
     fname_ (fname),
@@ -32,7 +175,10 @@ Loading::Loading (const QString& fname, const QString& charset, bool reload,
     saveCursor_ (saveCursor),
     forceUneditable_ (forceUneditable),
     multiple_ (multiple)
-{}
+{
+    qRegisterMetaType<QSharedPointer<PagedFile> >();
+    qRegisterMetaType<LineIndex>();
+}
 /*************************/
 Loading::~Loading() {}
 /*************************/
@@ -45,9 +191,29 @@ void Loading::run()
     }
 
     QFile file (fname_);
-    if (file.size() > 100*1024*1024) // don't open files with sizes > 100 Mib
+    if (file.size() > PAGING_SIZE) // don't put files with sizes > 100 Mib into documents
     {
-        emit completed (QString(), fname_);
+        /* the shared pointer deletes the paged file if it isn't delivered */
+        QSharedPointer<PagedFile> pagedFile (new PagedFile (fname_));
+        if (!pagedFile->open())
+        {
+            emit completed (QString(), fname_);
+            return;
+        }
+        bool enforced = !charset_.isEmpty();
+        bool sure = true;
+        pagedFile->setCharset (enforced ? charset_ : pagedFile->guessCharset (&sure));
+        emit completed (pagedFile->page (0),
+                        fname_,
+                        pagedFile->charset(),
+                        enforced,
+                        reload_,
+                        saveCursor_,
+                        true, // a paged file is never editable
+                        multiple_,
+                        pagedFile,
+                        LineIndex(),
+                        !sure);
         return;
     }
     if (!file.open (QFile::ReadOnly))
@@ -56,84 +222,74 @@ void Loading::run()
         return;
     }
 
-    /* read the file character by character to know
-       if it includes null (and because that's faster) */
+    /* get all bytes at once instead of reading them one by one */
+    QByteArray buffer;
+    qint64 size;
+    const char *bytes = fileBytes (file, buffer, size);
+    const char *end = bytes + size;
+
     bool enforced = !charset_.isEmpty();
+    bool sure = true;
     bool hasNull = false;
-    QByteArray data;
-    char c;
-    qint64 charSize = sizeof (char); // 1
-    if (enforced)
-    { // no need to check for the null character here
-        while (file.read (&c, charSize) > 0)
-            data.append (c);
-    }
-    else
+    QByteArray data; // made only if the bytes should be changed
+    if (!enforced) // no need to check for the null character otherwise
     {
-        unsigned char C[4];
-        int num = 0;
+        const unsigned char *C = reinterpret_cast<const unsigned char*>(bytes);
         /* checking 4 bytes is enough to guess
            whether the encoding is UTF-16 or UTF-32 */
-        while (num < 4 && file.read (&c, charSize) > 0)
-        {
-            data.append (c);
-            if (c == '\0')
-                hasNull = true;
-            C[num] = c;
-            ++ num;
-        }
+        const int num = static_cast<int>(qMin (size, static_cast<qint64>(4)));
+        hasNull = (memchr (bytes, '\0', num) != nullptr);
         if (num == 2 && ((C[0] != '\0' && C[1] == '\0') || (C[0] == '\0' && C[1] != '\0')))
             charset_ = "UTF-16"; // single character
-        else if (num == 4)
+        else if (num == 4 && hasNull)
         {
-            if (hasNull)
+            if ((C[0] == 0xFF && C[1] == 0xFE && C[2] != '\0' && C[3] == '\0') // le
+                || (C[0] == 0xFE && C[1] == 0xFF && C[2] == '\0' && C[3] != '\0') // be
+                || (C[0] != '\0' && C[1] == '\0' && C[2] != '\0' && C[3] == '\0') // le
+                || (C[0] == '\0' && C[1] != '\0' && C[2] == '\0' && C[3] != '\0')) // be
             {
-                if ((C[0] == 0xFF && C[1] == 0xFE && C[2] != '\0' && C[3] == '\0') // le
-                    || (C[0] == 0xFE && C[1] == 0xFF && C[2] == '\0' && C[3] != '\0') // be
-                    || (C[0] != '\0' && C[1] == '\0' && C[2] != '\0' && C[3] == '\0') // le
-                    || (C[0] == '\0' && C[1] != '\0' && C[2] == '\0' && C[3] != '\0')) // be
-                {
-                    charset_ = "UTF-16";
-                }
-                /*else if ((C[0] == 0xFF && C[1] == 0xFE && C[2] == '\0' && C[3] == '\0')
-                          || (C[0] == '\0' && C[1] == '\0' && C[2] == 0xFE && C[3] == 0xFF))*/
-                else if ((C[0] != '\0' && C[1] != '\0' && C[2] == '\0' && C[3] == '\0') // le
-                         || (C[0] == '\0' && C[1] == '\0' && C[2] != '\0' && C[3] != '\0')) // be
-                {
-                    charset_ = "UTF-32";
-                }
+                charset_ = "UTF-16";
             }
-            /* reading may still be possible */
-            if (charset_.isEmpty() && !hasNull)
+            /*else if ((C[0] == 0xFF && C[1] == 0xFE && C[2] == '\0' && C[3] == '\0')
+                      || (C[0] == '\0' && C[1] == '\0' && C[2] == 0xFE && C[3] == 0xFF))*/
+            else if ((C[0] != '\0' && C[1] != '\0' && C[2] == '\0' && C[3] == '\0') // le
+                     || (C[0] == '\0' && C[1] == '\0' && C[2] != '\0' && C[3] != '\0')) // be
             {
-                int num = 0;
-                while (file.read (&c, charSize) > 0)
+                charset_ = "UTF-32";
+            }
+        }
+
+        if (num == 4 && charset_.isEmpty() && !hasNull)
+        { // reading may still be possible
+            hasNull = (memchr (bytes + num, '\0', size - num) != nullptr);
+
+            /* truncate huge lines but copy other lines in large spans */
+            const char *spanStart = bytes;
+            const char *lineStart = bytes;
+            const char *nextLF = nullptr, *nextCR = nullptr;
+            while (lineStart < end)
+            {
+                const char *lineEnd = nextLineEnd (lineStart, end, nextLF, nextCR);
+                if (lineEnd - lineStart > MAX_LINE_LENGTH)
                 {
-                    if (c == '\0')
-                    {
-                        if (!hasNull)
-                            hasNull = true;
-                    }
-                    else if (c == '\n' || c == '\r')
-                        num = 0;
-                    if (num <= 500000)
-                        data.append (c);
-                    else if (num == 500001)
-                    {
-                        data += QByteArray ("    HUGE LINE TRUNCATED: NO LINE WITH MORE THAN 500000 CHARACTERS");
-                        forceUneditable_ = true;
-                    }
-                    ++num;
+                    if (data.isNull())
+                        data.reserve (static_cast<int>(size));
+                    data.append (spanStart, static_cast<int>(lineStart + MAX_LINE_LENGTH - spanStart));
+                    data += QByteArray ("    HUGE LINE TRUNCATED: NO LINE WITH MORE THAN 500000 CHARACTERS");
+                    forceUneditable_ = true;
+                    spanStart = lineEnd;
                 }
+                if (lineEnd == end) break;
+                lineStart = lineEnd + 1;
+                if (*lineEnd == '\r' && lineStart < end && *lineStart == '\n')
+                    ++lineStart; // "\r\n" is a single line break
             }
-            else
-            { // the meaning of null characters was determined before
-                while (file.read (&c, charSize) > 0)
-                    data.append (c);
-            }
+            if (!data.isNull() && spanStart < end)
+                data.append (spanStart, static_cast<int>(end - spanStart));
         }
     }
-    file.close();
+    if (data.isNull()) // use the mapped bytes directly (until the file is closed)
+        data = QByteArray::fromRawData (bytes, static_cast<int>(size));
 
     if (charset_.isEmpty())
     {
@@ -143,7 +299,7 @@ void Loading::run()
             charset_ = "UTF-8"; // always open non-text files as UTF-8
         }
         else
-            charset_ = detectCharset (data);
+            charset_ = detectCharset (data, &sure);
     }
 
     QTextCodec *codec = QTextCodec::codecForName (charset_.toUtf8()); // or charset.toStdString().c_str()
@@ -153,7 +309,13 @@ void Loading::run()
         codec = QTextCodec::codecForName ("UTF-8");
     }
 
-    QString text = codec->toUnicode (data);
+    QString text = decode (codec, data);
+    data = QByteArray();
+    file.close(); // also unmaps the file
+    buffer = QByteArray();
+    /* index the lines here, instead of leaving it to the GUI thread */
+    LineIndex lineIndex;
+    lineIndex.indexText (text);
     emit completed (text,
                     fname_,
                     charset_,
@@ -161,7 +323,10 @@ void Loading::run()
                     reload_,
                     saveCursor_,
                     forceUneditable_,
-                    multiple_);
+                    multiple_,
+                    nullptr,
+                    lineIndex,
+                    !sure);
 }
 
 }
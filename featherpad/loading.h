@@ -21,6 +21,8 @@
 #define LOADING_H
 
 #include <QThread>
+#include "pagedfile.h"
+#include "lineindex.h"
 
 namespace FeatherPad {
 
@@ -40,7 +42,10 @@ signals:
                     bool reload = false,
                     bool saveCursor = false,
                     bool uneditable = false,
-                    bool multiple = false);
+                    bool multiple = false,
+                    QSharedPointer<PagedFile> pagedFile = QSharedPointer<PagedFile>(), // for huge files
+                    const LineIndex& lineIndex = LineIndex(),
+                    bool uncertainCharset = false); // Is the encoding a guess?
 
 private:
     void run();
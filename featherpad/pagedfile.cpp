@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+
+#include "pagedfile.h"
+#include "encoding.h"
+#include <QTextCodec>
+#include <climits>
+#include <string.h> // memchr
+
+namespace FeatherPad {
+
+const int PagedFile::PAGE_LINES; // it's bound to references by qMin()
+
+/* The offset of every LINE_STRIDE-th line is indexed. */
+static const int LINE_STRIDE = 64;
+/* No line may have more than this number of characters. */
+static const int MAX_LINE_LENGTH = 500000;
+/* A page is decoded until it has at least this number of bytes. */
+static const int PAGE_BYTES = 1024*1024;
+/* The batches of lines that are decoded at once when searching. */
+static const int SEARCH_LINES = 8192;
+static const int SEARCH_BYTES = 4*1024*1024;
+/* The number of bytes that are looked at for guessing the encoding. */
+static const int SAMPLE_SIZE = 1024*1024;
+
+/* Finds the string in the text while respecting the search flags. */
+static int findInText (const QString& text, const QString& str, bool backward,
+                       Qt::CaseSensitivity cs, bool wholeWords)
+{
+    int idx = backward ? text.lastIndexOf (str, -1, cs) : text.indexOf (str, 0, cs);
+    while (idx > -1 && wholeWords)
+    {
+        const int end = idx + str.length();
+        if ((idx == 0 || !text.at (idx - 1).isLetterOrNumber())
+            && (end == text.length() || !text.at (end).isLetterOrNumber()))
+        {
+            break;
+        }
+        if (backward)
+            idx = idx == 0 ? -1 : text.lastIndexOf (str, idx - 1, cs);
+        else
+            idx = text.indexOf (str, idx + 1, cs);
+    }
+    return idx;
+}
+/*************************/
+PagedFile::PagedFile (const QString& fname) :
+    file_ (fname),
+    fname_ (fname),
+    codec_ (nullptr),
+    data_ (nullptr),
+    size_ (0),
+    lineCount_ (0)
+{
+    setCharset ("UTF-8");
+}
+/*************************/
+PagedFile::~PagedFile()
+{
+    file_.close(); // also unmaps the file
+}
+/*************************/
+bool PagedFile::open()
+{
+    if (!file_.open (QFile::ReadOnly))
+        return false;
+    size_ = file_.size();
+    uchar *map = size_ > 0 ? file_.map (0, size_) : nullptr;
+    if (map == nullptr) // e.g., not enough address space
+    {
+        file_.close();
+        return false;
+    }
+    data_ = reinterpret_cast<const char*>(map);
+
+    /* count the lines and remember where every LINE_STRIDE-th line starts */
+    const char *end = data_ + size_;
+    const char *p = data_;
+    index_.append (0);
+    lineCount_ = 1;
+    while (lineCount_ < INT_MAX
+           && (p = static_cast<const char*>(memchr (p, '\n', end - p))) != nullptr)
+    {
+        ++p;
+        if (lineCount_ % LINE_STRIDE == 0)
+            index_.append (p - data_);
+        ++lineCount_;
+    }
+    return true;
+}
+/*************************/
+QString PagedFile::guessCharset (bool *sure) const
+{
+    int n = static_cast<int>(qMin (size_, static_cast<qint64>(SAMPLE_SIZE)));
+    if (n < size_)
+    { // don't cut a multibyte character
+        int i = n - 1;
+        while (i > 0 && data_[i] != '\n') --i;
+        if (i > 0) n = i + 1;
+    }
+    if (memchr (data_, '\0', n) != nullptr)
+    {
+        if (sure)
+            *sure = true;
+        return "UTF-8"; // non-text files are always opened as UTF-8
+    }
+    return detectCharset (QByteArray (data_, n), sure);
+}
+/*************************/
+void PagedFile::setCharset (const QString& charset)
+{
+    /* lines are found byte by byte, so that UTF-16 and UTF-32 can't be paged */
+    if (charset.startsWith ("UTF-16") || charset.startsWith ("UTF-32"))
+        codec_ = nullptr;
+    else
+        codec_ = QTextCodec::codecForName (charset.toUtf8());
+    if (codec_)
+        charset_ = charset;
+    else
+    {
+        charset_ = "UTF-8";
+        codec_ = QTextCodec::codecForName ("UTF-8");
+    }
+}
+/*************************/
+const char* PagedFile::lineStart (int line) const
+{
+    const char *end = data_ + size_;
+    const char *p = data_ + index_.at (line / LINE_STRIDE);
+    for (int i = line % LINE_STRIDE; i > 0; --i)
+        p = static_cast<const char*>(memchr (p, '\n', end - p)) + 1;
+    return p;
+}
+/*************************/
+// Decodes at most "count" lines, starting with "first", but stops when the text
+// has at least "maxBytes" bytes. "lineNum" will be the number of decoded lines.
+QString PagedFile::decodedLines (int first, int count, int maxBytes, int &lineNum) const
+{
+    lineNum = 0;
+    if (first < 0 || first >= lineCount_ || count <= 0)
+        return QString();
+    count = qMin (count, lineCount_ - first);
+
+    const char *end = data_ + size_;
+    const char *p = lineStart (first);
+    QByteArray bytes;
+    while (lineNum < count && (lineNum == 0 || bytes.size() < maxBytes))
+    {
+        const char *lineEnd = static_cast<const char*>(memchr (p, '\n', end - p));
+        if (lineEnd == nullptr)
+            lineEnd = end;
+        const char *textEnd = lineEnd;
+        if (textEnd > p && *(textEnd - 1) == '\r')
+            --textEnd;
+        if (lineNum > 0)
+            bytes += '\n';
+        if (textEnd - p > MAX_LINE_LENGTH)
+        {
+            bytes.append (p, MAX_LINE_LENGTH);
+            bytes += QByteArray ("    HUGE LINE TRUNCATED: NO LINE WITH MORE THAN 500000 CHARACTERS");
+        }
+        else
+            bytes.append (p, static_cast<int>(textEnd - p));
+        ++lineNum;
+        p = lineEnd + 1;
+    }
+    return codec_->toUnicode (bytes);
+}
+/*************************/
+QString PagedFile::page (int firstLine) const
+{
+    int n;
+    return decodedLines (firstLine, PAGE_LINES, PAGE_BYTES, n);
+}
+/*************************/
+int PagedFile::findLine (const QString& str, int from, int to, bool backward,
+                         Qt::CaseSensitivity cs, bool wholeWords) const
+{
+    from = qMax (from, 0);
+    to = qMin (to, lineCount_);
+    if (str.isEmpty() || from >= to)
+        return -1;
+
+    /* consecutive batches overlap by the number of line breaks in the
+       string, so that no match between two batches will be missed */
+    const int overlap = str.count (QLatin1Char ('\n'));
+    const int batch = qMax (SEARCH_LINES, overlap + 1);
+    int last = backward ? to : from + batch;
+    int first = backward ? qMax (from, to - batch) : from;
+    while (true)
+    {
+        last = qMin (last, to);
+        int found = -1;
+        int start = first;
+        while (start < last)
+        {
+            int n;
+            QString text = decodedLines (start, last - start, SEARCH_BYTES, n);
+            int idx = findInText (text, str, backward, cs, wholeWords);
+            if (idx > -1)
+            {
+                found = start + text.leftRef (idx).count (QLatin1Char ('\n'));
+                if (!backward)
+                    return found;
+            }
+            if (start + n >= last)
+                break;
+            start += qMax (n - overlap, 1);
+        }
+        if (found > -1)
+            return found;
+        if (backward)
+        {
+            if (first == from)
+                break;
+            last = first + overlap;
+            first = qMax (from, last - batch);
+        }
+        else
+        {
+            if (last == to)
+                break;
+            first = last - overlap;
+            last = first + batch;
+        }
+    }
+    return -1;
+}
+
+}
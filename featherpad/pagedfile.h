@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#ifndef PAGEDFILE_H
+#define PAGEDFILE_H
+
+#include <QFile>
+#include <QVector>
+#include <QSharedPointer>
+#include <QMetaType>
+
+class QTextCodec;
+
+namespace FeatherPad {
+
+/* A read-only view of a file that is too large to be put into a document.
+   The file is mapped into memory and only the offsets of every LINE_STRIDE-th
+   line are kept, so that a page of lines can be decoded on demand and searched
+   without the whole file ever being converted into a QString. */
+class PagedFile
+{
+public:
+    PagedFile (const QString& fname);
+    ~PagedFile();
+
+    /* maps the file and indexes its lines (to be called in the loading thread) */
+    bool open();
+
+    /* guesses the encoding by looking at the start of the file */
+    QString guessCharset (bool *sure = nullptr) const;
+    void setCharset (const QString& charset);
+    QString charset() const {
+        return charset_;
+    }
+
+    QString fileName() const {
+        return fname_;
+    }
+    qint64 size() const {
+        return size_;
+    }
+    int lineCount() const {
+        return lineCount_;
+    }
+
+    /* the text of the page starting with the given line (without the last newline) */
+    QString page (int firstLine) const;
+    /* the first line, in the range [from, to), that contains the string
+       (or the last one, if the search is backward), or -1 if there's none */
+    int findLine (const QString& str, int from, int to, bool backward,
+                  Qt::CaseSensitivity cs, bool wholeWords) const;
+
+    /* the maximum number of lines in a page */
+    static const int PAGE_LINES = 10000;
+
+private:
+    const char* lineStart (int line) const;
+    QString decodedLines (int first, int count, int maxBytes, int &lineNum) const;
+
+    QFile file_;
+    QString fname_;
+    QString charset_;
+    QTextCodec *codec_;
+    const char *data_;
+    qint64 size_;
+    int lineCount_;
+    QVector<qint64> index_; // the offsets of lines 0, LINE_STRIDE, 2*LINE_STRIDE,...
+};
+
+}
+
+Q_DECLARE_METATYPE(QSharedPointer<FeatherPad::PagedFile>)
+
+#endif // PAGEDFILE_H
@@ -253,6 +253,13 @@ PrefDialog::PrefDialog (const QHash<QString, QString> &defaultShortcuts, QWidget
     ui->autoSaveSpin->setEnabled (ui->autoSaveBox->isChecked());
     connect (ui->autoSaveBox, &QCheckBox::stateChanged, this, &PrefDialog::prefAutoSave);
 
+    ui->lazyTabsBox->setChecked (config.getLazyTabs());
+    connect (ui->lazyTabsBox, &QCheckBox::stateChanged, this, &PrefDialog::prefLazyTabs);
+
+    ui->memorySpin->setValue (config.getMemoryBudget());
+    connect (ui->memorySpin, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+             this, &PrefDialog::prefMemoryBudget);
+
     /*****************
      *** Shortcuts ***
      *****************/
@@ -1308,6 +1315,21 @@ void PrefDialog::prefAutoSave (int checked)
         ui->autoSaveSpin->setEnabled (false);
 }
 /*************************/
+void PrefDialog::prefLazyTabs (int checked)
+{
+    Config& config = static_cast<FPsingleton*>(qApp)->getConfig();
+    if (checked == Qt::Checked)
+        config.setLazyTabs (true);
+    else if (checked == Qt::Unchecked)
+        config.setLazyTabs (false);
+}
+/*************************/
+void PrefDialog::prefMemoryBudget (int value)
+{
+    Config& config = static_cast<FPsingleton*>(qApp)->getConfig();
+    config.setMemoryBudget (value);
+}
+/*************************/
 void PrefDialog::prefApplyAutoSave()
 {
     FPsingleton *singleton = static_cast<FPsingleton*>(qApp);
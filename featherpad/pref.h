@@ -95,6 +95,8 @@ private slots:
     void defaultSortcuts();
     void onShortcutChange (QTableWidgetItem *item);
     void prefAutoSave (int checked);
+    void prefLazyTabs (int checked);
+    void prefMemoryBudget (int value);
 
 private:
     void closeEvent (QCloseEvent *event);
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#ifndef REGEXPS_H
+#define REGEXPS_H
+
+#include <QRegularExpression>
+
+namespace FeatherPad {
+
+/* The regular expressions of hot paths (like highlighting and painting of text
+   blocks) are created by precompiled() once and kept in static variables. They
+   are optimized (JIT-compiled) immediately. Because copies of a regex share its
+   compiled pattern, they aren't compiled again. (The benchmark counts the real
+   compilations of PCRE2 patterns to check that.) */
+QRegularExpression precompiled (const QString &pattern);
+
+}
+
+#endif // REGEXPS_H
@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#include "regexsearch.h"
+#include <QElapsedTimer>
+#include <QList>
+
+namespace FeatherPad {
+
+class RegexWorker : public QThread
+{
+public:
+    RegexWorker (const std::function<void()> &work) : work_ (work) {}
+
+protected:
+    void run() {
+        work_();
+    }
+
+private:
+    std::function<void()> work_;
+};
+
+/* The abandoned workers that haven't finished (see abandonWorker()). They're
+   used only in the GUI thread and are waited for when the program exits. */
+struct AbandonedWorkers
+{
+    ~AbandonedWorkers() {
+        QElapsedTimer timer;
+        timer.start();
+        const QList<QThread*> remaining = workers;
+        for (QThread *worker : remaining)
+        {
+            worker->requestInterruption();
+            const qint64 t = EXIT_WAIT - timer.elapsed();
+            if (worker->wait (t > 0 ? static_cast<unsigned long>(t) : 0))
+                delete worker;
+        }
+    }
+
+    static const int EXIT_WAIT = 2000; // the maximum time of waiting for all workers at exit (in ms)
+    QList<QThread*> workers;
+};
+
+static AbandonedWorkers& abandonedWorkers()
+{
+    static AbandonedWorkers abandoned;
+    return abandoned;
+}
+
+static const int BACKWARD_WINDOW = 4096; // the first part of the text that is searched backward
+
+static inline bool isInterrupted()
+{
+    return QThread::currentThread()->isInterruptionRequested();
+}
+/*************************/
+void abandonWorker (QThread *worker)
+{
+    worker->requestInterruption();
+    QList<QThread*> &workers = abandonedWorkers().workers;
+    workers.append (worker);
+    /* the worker is deleted only once, even if it has finished in the meantime */
+    QObject::connect (worker, &QThread::finished, worker, [worker] {
+        if (abandonedWorkers().workers.removeOne (worker))
+            worker->deleteLater();
+    });
+    if (worker->isFinished() && workers.removeOne (worker))
+        worker->deleteLater();
+}
+/*************************/
+RegexSearch::RegexSearch (const QString& pattern, QTextDocument::FindFlags flags) :
+    RegexSearch (pattern,
+                 flags & QTextDocument::FindCaseSensitively ? Qt::CaseSensitive : Qt::CaseInsensitive)
+{}
+/*************************/
+RegexSearch::RegexSearch (const QString& pattern, Qt::CaseSensitivity cs)
+{
+    QRegularExpression::PatternOptions options = QRegularExpression::MultilineOption;
+    if (cs == Qt::CaseInsensitive)
+        options |= QRegularExpression::CaseInsensitiveOption;
+    regex_.setPattern (pattern);
+    regex_.setPatternOptions (options);
+#if QT_VERSION >= 0x050400
+    if (regex_.isValid())
+        regex_.optimize();
+#endif
+}
+/*************************/
+QRegularExpressionMatch RegexSearch::indexIn (const QString& text, int from) const
+{
+    if (!regex_.isValid()) return QRegularExpressionMatch();
+    QRegularExpressionMatchIterator it = regex_.globalMatch (text, from);
+    while (it.hasNext() && !isInterrupted())
+    {
+        QRegularExpressionMatch match = it.next();
+        if (match.capturedLength() > 0)
+            return match;
+    }
+    return QRegularExpressionMatch();
+}
+/*************************/
+// Searches the text before "to" in parts that get larger, so that
+// a match near "to" is found fast.
+QRegularExpressionMatch RegexSearch::lastIndexIn (const QString& text, int to) const
+{
+    if (!regex_.isValid() || to <= 0) return QRegularExpressionMatch();
+    QRegularExpressionMatch res;
+    int window = BACKWARD_WINDOW;
+    int from = to;
+    while (from > 0)
+    {
+        from = qMax (to - window, 0);
+        QRegularExpressionMatchIterator it = regex_.globalMatch (text, from);
+        while (it.hasNext())
+        {
+            if (isInterrupted()) return QRegularExpressionMatch();
+            QRegularExpressionMatch match = it.next();
+            if (match.capturedEnd() > to)
+                break;
+            if (match.capturedLength() > 0)
+                res = match;
+        }
+        if (res.hasMatch()) break;
+        window *= 8;
+    }
+    return res;
+}
+/*************************/
+QVector<QRegularExpressionMatch> RegexSearch::allMatches (const QString& text) const
+{
+    QVector<QRegularExpressionMatch> res;
+    if (!regex_.isValid()) return res;
+    QRegularExpressionMatchIterator it = regex_.globalMatch (text);
+    while (it.hasNext())
+    {
+        if (isInterrupted()) return QVector<QRegularExpressionMatch>();
+        QRegularExpressionMatch match = it.next();
+        if (match.capturedLength() > 0)
+            res.append (match);
+    }
+    return res;
+}
+/*************************/
+QString RegexSearch::substituted (const QString& replacement, const QRegularExpressionMatch& match)
+{
+    QString res;
+    const int n = replacement.length();
+    res.reserve (n);
+    for (int i = 0; i < n; ++i)
+    {
+        const QChar c = replacement.at (i);
+        if (c == QLatin1Char ('\\') && i + 1 < n)
+        {
+            const ushort next = replacement.at (i + 1).unicode();
+            if (next >= '0' && next <= '9')
+            {
+                res += match.captured (next - '0');
+                ++i;
+                continue;
+            }
+            if (next == 'n' || next == 't' || next == '\\')
+            {
+                res += next == 'n' ? QLatin1Char ('\n')
+                                   : next == 't' ? QLatin1Char ('\t') : QLatin1Char ('\\');
+                ++i;
+                continue;
+            }
+        }
+        res += c;
+    }
+    return res;
+}
+/*************************/
+RegexMatcher::RegexMatcher (QObject *parent) : QObject (parent)
+{
+    worker_ = nullptr;
+    ignored_ = false;
+    timer_ = new QTimer (this);
+    timer_->setSingleShot (true);
+    timer_->setInterval (REGEX_TIMEOUT);
+    connect (timer_, &QTimer::timeout, this, &RegexMatcher::onTimeout);
+}
+/*************************/
+RegexMatcher::~RegexMatcher()
+{
+    if (worker_ != nullptr)
+    { // never wait for a regex match in the GUI thread
+        disconnect (worker_, &QThread::finished, this, &RegexMatcher::onWorkerFinished);
+        abandonWorker (worker_);
+        worker_ = nullptr;
+    }
+}
+/*************************/
+// The worker doesn't refer to this object, which may be deleted before it.
+bool RegexMatcher::start (const RegexSearch& search, const QString& text, Mode mode, int pos, bool wrap)
+{
+    if (worker_ != nullptr) return false;
+
+    QSharedPointer<QVector<QRegularExpressionMatch> > result (new QVector<QRegularExpressionMatch>);
+    worker_ = new RegexWorker ([=] {
+        if (mode == All)
+        {
+            *result = search.allMatches (text);
+            return;
+        }
+        QRegularExpressionMatch match;
+        if (mode == Forward)
+        {
+            match = search.indexIn (text, pos);
+            if (wrap && !match.hasMatch() && pos > 0)
+                match = search.indexIn (text, 0);
+        }
+        else
+        {
+            match = search.lastIndexIn (text, pos);
+            if (wrap && !match.hasMatch() && pos < text.length())
+                match = search.lastIndexIn (text, text.length());
+        }
+        if (match.hasMatch())
+            result->append (match);
+    });
+    result_ = result;
+    ignored_ = false;
+    connect (worker_, &QThread::finished, this, &RegexMatcher::onWorkerFinished);
+    worker_->start();
+    timer_->start();
+    return true;
+}
+/*************************/
+void RegexMatcher::cancel()
+{
+    if (worker_ == nullptr) return;
+    ignored_ = true;
+    timer_->stop();
+    worker_->requestInterruption();
+}
+/*************************/
+void RegexMatcher::onTimeout()
+{
+    if (worker_ == nullptr) return;
+    cancel();
+    emit timedOut();
+}
+/*************************/
+void RegexMatcher::onWorkerFinished()
+{
+    if (worker_ == nullptr) return;
+    timer_->stop();
+    worker_->wait(); // "finished()" is emitted just before the thread finishes
+    delete worker_;
+    worker_ = nullptr;
+    const QVector<QRegularExpressionMatch> matches = *result_;
+    result_.clear();
+    if (!ignored_)
+        emit matched (matches);
+}
+
+}
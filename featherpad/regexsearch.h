@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#ifndef REGEXSEARCH_H
+#define REGEXSEARCH_H
+
+#include <QRegularExpression>
+#include <QTextDocument>
+#include <QSharedPointer>
+#include <QVector>
+#include <QThread>
+#include <QTimer>
+#include <functional>
+
+namespace FeatherPad {
+
+static const int REGEX_TIMEOUT = 2000; // the maximum time of a regex search (in ms)
+
+/* A regular expression search in a contiguous text (usually, a snapshot of a
+   document). The pattern is JIT-compiled once. "^" and "$" match at line
+   boundaries and empty matches are skipped. The search functions are meant
+   to be called in worker threads; they stop early, without a match, if the
+   interruption of their thread is requested, but a single match of PCRE
+   can't be interrupted. */
+class RegexSearch
+{
+public:
+    RegexSearch (const QString& pattern, Qt::CaseSensitivity cs);
+    /* only the case sensitivity flag is considered */
+    RegexSearch (const QString& pattern, QTextDocument::FindFlags flags);
+
+    bool isValid() const {
+        return regex_.isValid();
+    }
+    const QRegularExpression& regex() const {
+        return regex_;
+    }
+
+    /* the first match that starts at or after "from" (without match if none) */
+    QRegularExpressionMatch indexIn (const QString& text, int from) const;
+    /* the last match that ends at or before "to" (without match if none) */
+    QRegularExpressionMatch lastIndexIn (const QString& text, int to) const;
+    /* all matches in the order of their positions */
+    QVector<QRegularExpressionMatch> allMatches (const QString& text) const;
+
+    /* the replacement of a match, in which "\0"..."\9" are replaced by
+       the captured texts, "\n" and "\t" by a newline and a tab, and "\\"
+       by a backslash (like in QString::replace() with a regex) */
+    static QString substituted (const QString& replacement, const QRegularExpressionMatch& match);
+
+private:
+    QRegularExpression regex_;
+};
+
+/* Runs regex searches in a worker thread, one at a time, and reports their
+   results by signals. If a search takes too long, its thread is interrupted,
+   timedOut() is emitted and the result is ignored; since the thread may still
+   be in a long match, no other search is started until it finishes. */
+class RegexMatcher : public QObject
+{
+    Q_OBJECT
+public:
+    enum Mode {
+        Forward,
+        Backward,
+        All
+    };
+
+    RegexMatcher (QObject *parent = nullptr);
+    ~RegexMatcher();
+
+    /* whether a search is running (even if its result will be ignored) */
+    bool isBusy() const {
+        return worker_ != nullptr;
+    }
+    /* Starts a search and returns true, or returns false if another search is
+       running. A forward search starts at "pos" and a backward one ends there;
+       both may wrap around. */
+    bool start (const RegexSearch& search, const QString& text, Mode mode, int pos, bool wrap = true);
+    /* the result of the running search will be ignored */
+    void cancel();
+
+signals:
+    void matched (const QVector<QRegularExpressionMatch>& matches); // "matches" may be empty
+    void timedOut();
+
+private slots:
+    void onWorkerFinished();
+    void onTimeout();
+
+private:
+    QThread *worker_;
+    QSharedPointer<QVector<QRegularExpressionMatch> > result_;
+    QTimer *timer_;
+    bool ignored_;
+};
+
+/* Leaves an interrupted worker thread, which may be in a long regex match,
+   to finish by itself and be deleted then. Threads that haven't finished
+   are waited for a limited time when the application exits. */
+void abandonWorker (QThread *worker);
+
+}
+
+#endif // REGEXSEARCH_H
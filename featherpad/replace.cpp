@@ -19,6 +19,8 @@
 
 #include "fpwin.h"
 #include "ui_fp.h"
+#include "textsearch.h"
+#include "regexsearch.h"
 
 namespace FeatherPad {
 
@@ -123,6 +125,22 @@ void FPwin::replace()
         removeGreenSel();
     }
 
+    bool forward (QObject::sender() == ui->toolButtonNext); // otherwise, it's ui->toolButtonPrv
+    if (isRegexSearch())
+    { // the match will be replaced when it's found (-> regexMatched())
+        startRegexSearch (textEdit, txtFind, forward ? RegexMatcher::Forward : RegexMatcher::Backward,
+                          REGEX_REPLACE);
+        return;
+    }
+    QTextDocument::FindFlags searchFlags = getSearchFlags();
+    if (!forward)
+        searchFlags |= QTextDocument::FindBackward;
+    replaceFound (textEdit, finding (txtFind, textEdit->textCursor(), searchFlags), txtReplace_);
+}
+/*************************/
+// Replaces the found text (if it isn't null) and highlights the replacement.
+void FPwin::replaceFound (TextEdit *textEdit, const QTextCursor& found, const QString& replacement)
+{
     bool lineNumShown (ui->actionLineNumbers->isChecked() || ui->spinBox->isVisible());
 
     /* remember all previous (yellow and) green highlights */
@@ -136,14 +154,8 @@ void FPwin::replace()
     if (!es.isEmpty() && lineNumShown)
         es.removeFirst();
 
-    QTextDocument::FindFlags searchFlags = getSearchFlags();
     QTextCursor start = textEdit->textCursor();
     QTextCursor tmp = start;
-    QTextCursor found;
-    if (QObject::sender() == ui->toolButtonNext)
-        found = finding (txtFind, start, searchFlags);
-    else// if (QObject::sender() == ui->toolButtonPrv)
-        found = finding (txtFind, start, searchFlags | QTextDocument::FindBackward);
     QColor color = QColor (textEdit->hasDarkScheme() ? Qt::darkGreen : Qt::green);
     int pos;
     QList<QTextEdit::ExtraSelection> gsel = textEdit->getGreenSel();
@@ -153,7 +165,7 @@ void FPwin::replace()
         pos = found.anchor();
         start.setPosition (found.position(), QTextCursor::KeepAnchor);
         textEdit->setTextCursor (start);
-        textEdit->insertPlainText (txtReplace_);
+        textEdit->insertPlainText (replacement);
 
         start = textEdit->textCursor();
         tmp.setPosition (pos);
@@ -194,35 +206,57 @@ void FPwin::replaceAll()
         removeGreenSel();
     }
 
-    QTextDocument::FindFlags searchFlags = getSearchFlags();
+    if (isRegexSearch())
+    { // the matches will be replaced when they're found (-> regexMatched())
+        startRegexSearch (textEdit, txtFind, RegexMatcher::All, REGEX_REPLACE_ALL);
+        return;
+    }
 
+    /* find all matches in a snapshot of the text before replacing them */
+    const QString &text = textEdit->textSnapshot();
+    QVector<int> matches, lengths;
+    TextSearch search (txtFind, getSearchFlags());
+    int i = 0;
+    while ((i = search.indexIn (text, i)) != -1)
+    {
+        matches.append (i);
+        lengths.append (search.length());
+        i += search.length();
+    }
+    replaceAllMatches (textEdit, matches, lengths, QStringList());
+}
+/*************************/
+// Replaces the matches by the replacing text or, if "replacements" isn't empty,
+// by their own replacements, and shows the number of replacements.
+void FPwin::replaceAllMatches (TextEdit *textEdit, const QVector<int>& matches, const QVector<int>& lengths,
+                               const QStringList& replacements)
+{
     QTextCursor orig = textEdit->textCursor();
     QTextCursor start = orig;
     QColor color = QColor (textEdit->hasDarkScheme() ? Qt::darkGreen : Qt::green);
-    int pos; QTextCursor found;
     start.beginEditBlock();
-    start.setPosition (0);
-    QTextCursor tmp = start;
     QList<QTextEdit::ExtraSelection> gsel = textEdit->getGreenSel();
     QList<QTextEdit::ExtraSelection> es;
-    int count = 0;
-    while (!(found = finding (txtFind, start, searchFlags)).isNull())
+    /* replace from the end, so that the positions of the previous matches don't change
+       (the cursors of the green highlights will be moved by the text document) */
+    for (int j = matches.count() - 1; j >= 0; --j)
     {
-        start.setPosition (found.anchor());
-        pos = found.anchor();
-        start.setPosition (found.position(), QTextCursor::KeepAnchor);
-        start.insertText (txtReplace_);
+        const int pos = matches.at (j);
+        start.setPosition (pos);
+        start.setPosition (pos + lengths.at (j), QTextCursor::KeepAnchor);
+        start.insertText (replacements.isEmpty() ? txtReplace_ : replacements.at (j));
 
+        QTextCursor tmp = start;
         tmp.setPosition (pos);
         tmp.setPosition (start.position(), QTextCursor::KeepAnchor);
-        start.setPosition (start.position());
         QTextEdit::ExtraSelection extra;
         extra.format.setBackground (color);
         extra.cursor = tmp;
-        es.prepend (extra);
-        gsel.append (extra);
-        ++count;
+        es.append (extra);
     }
+    for (int j = es.count() - 1; j >= 0; --j)
+        gsel.append (es.at (j));
+    int count = matches.count();
     textEdit->setGreenSel (gsel);
     start.endEditBlock();
     if ((ui->actionLineNumbers->isChecked() || ui->spinBox->isVisible()))
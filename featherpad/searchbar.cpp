@@ -44,6 +44,10 @@ SearchBar::SearchBar(QWidget *parent,
         wholeShortcut = shortcuts.at (3);
     }
 
+    label_count_ = new QLabel (this);
+    label_count_->setEnabled (false); // to look like a hint
+    label_count_->hide();
+
     /* See the comment about KAcceleratorManager in "fpwin.cpp". */
 
     toolButton_nxt_ = new QToolButton (this);
@@ -84,6 +88,14 @@ SearchBar::SearchBar(QWidget *parent,
     button_whole_->setCheckable (true);
     button_whole_->setFocusPolicy (Qt::NoFocus);
 
+    button_regex_ = new QToolButton (this);
+    if (hasText)
+        button_regex_->setText (tr ("Regular Expression"));
+    else
+        button_regex_->setToolTip (tr ("Regular Expression"));
+    button_regex_->setCheckable (true);
+    button_regex_->setFocusPolicy (Qt::NoFocus);
+
     /* there are shortcuts for forward/backward search */
     toolButton_nxt_->setFocusPolicy (Qt::NoFocus);
     toolButton_prv_->setFocusPolicy (Qt::NoFocus);
@@ -92,11 +104,13 @@ SearchBar::SearchBar(QWidget *parent,
     mainGrid->setHorizontalSpacing (3);
     mainGrid->setContentsMargins (2, 0, 2, 0);
     mainGrid->addWidget (lineEdit_, 0, 0);
-    mainGrid->addWidget (toolButton_nxt_, 0, 1);
-    mainGrid->addWidget (toolButton_prv_, 0, 2);
-    mainGrid->addItem (new QSpacerItem (6, 3), 0, 3);
-    mainGrid->addWidget (button_case_, 0, 4);
-    mainGrid->addWidget (button_whole_, 0, 5);
+    mainGrid->addWidget (label_count_, 0, 1);
+    mainGrid->addWidget (toolButton_nxt_, 0, 2);
+    mainGrid->addWidget (toolButton_prv_, 0, 3);
+    mainGrid->addItem (new QSpacerItem (6, 3), 0, 4);
+    mainGrid->addWidget (button_case_, 0, 5);
+    mainGrid->addWidget (button_whole_, 0, 6);
+    mainGrid->addWidget (button_regex_, 0, 7);
     setLayout (mainGrid);
 
     connect (lineEdit_, &QLineEdit::returnPressed, this, &SearchBar::findForward);
@@ -104,6 +118,7 @@ SearchBar::SearchBar(QWidget *parent,
     connect (toolButton_prv_, &QAbstractButton::clicked, this, &SearchBar::findBackward);
     connect (button_case_, &QAbstractButton::clicked, this, &SearchBar::searchFlagChanged);
     connect (button_whole_, &QAbstractButton::clicked, this, &SearchBar::searchFlagChanged);
+    connect (button_regex_, &QAbstractButton::clicked, this, &SearchBar::searchFlagChanged);
 }
 /*************************/
 void SearchBar::focusLineEdit()
@@ -147,6 +162,39 @@ bool SearchBar::matchWhole() const
     return button_whole_->isChecked();
 }
 /*************************/
+bool SearchBar::matchRegex() const
+{
+    return button_regex_->isChecked();
+}
+/*************************/
+void SearchBar::showMatchCount (int k, int n, bool complete)
+{
+    QString total = QString::number (n);
+    if (!complete)
+        total += "+";
+    QString text;
+    if (k > 0)
+        text = tr ("%1 of %2").arg (k).arg (total);
+    else if (n > 0)
+        text = complete && n == 1 ? tr ("One match") : tr ("%1 matches").arg (total);
+    else if (complete)
+        text = tr ("No match");
+    label_count_->setText (text);
+    label_count_->show();
+}
+/*************************/
+void SearchBar::showMessage (const QString& message)
+{
+    label_count_->setText (message);
+    label_count_->show();
+}
+/*************************/
+void SearchBar::hideMatchCount()
+{
+    if (!label_count_->isHidden())
+        label_count_->hide();
+}
+/*************************/
 // Used only in a workaround (-> FPwin::updateShortcuts())
 void SearchBar::updateShortcuts (bool disable)
 {
@@ -167,12 +215,13 @@ void SearchBar::updateShortcuts (bool disable)
 }
 /*************************/
 void SearchBar::setSearchIcons (const QIcon& iconNext, const QIcon& iconPrev,
-                                const QIcon& wholeIcon, const QIcon& caseIcon)
+                                const QIcon& wholeIcon, const QIcon& caseIcon, const QIcon& regexIcon)
 {
     toolButton_nxt_->setIcon (iconNext);
     toolButton_prv_->setIcon (iconPrev);
     button_whole_->setIcon (wholeIcon);
     button_case_->setIcon (caseIcon);
+    button_regex_->setIcon (regexIcon);
 }
 
 }
@@ -22,6 +22,7 @@
 
 #include <QPointer>
 #include <QPushButton>
+#include <QLabel>
 #include "lineedit.h"
 
 namespace FeatherPad {
@@ -42,10 +43,17 @@ public:
 
     bool matchCase() const;
     bool matchWhole() const;
+    bool matchRegex() const;
+
+    /* shows "k of N" (or N if k is zero), where N may be the number of matches found until now */
+    void showMatchCount (int k, int n, bool complete);
+    void hideMatchCount();
+    /* shows a message in place of the match count (until the count changes) */
+    void showMessage (const QString& message);
 
     void updateShortcuts (bool disable);
     void setSearchIcons (const QIcon& iconNext, const QIcon& iconPrev,
-                         const QIcon& wholeIcon, const QIcon& caseIcon);
+                         const QIcon& wholeIcon, const QIcon& caseIcon, const QIcon& regexIcon);
 
 signals:
     void searchFlagChanged();
@@ -56,10 +64,12 @@ private:
     void findBackward();
 
     QPointer<LineEdit> lineEdit_;
+    QPointer<QLabel> label_count_;
     QPointer<QToolButton> toolButton_nxt_;
     QPointer<QToolButton> toolButton_prv_;
     QPointer<QToolButton> button_case_;
     QPointer<QToolButton> button_whole_;
+    QPointer<QToolButton> button_regex_;
     QStringList shortcuts_;
 };
 
@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#include "searchindex.h"
+#include "textsearch.h"
+#include "regexsearch.h"
+#include "textedit.h"
+#include <QThread>
+#include <QMutex>
+#include <QTextBlock>
+#include <algorithm>
+
+namespace FeatherPad {
+
+class SearchScanner : public QThread
+{
+public:
+    SearchScanner (const QString &text, const QString &str, QTextDocument::FindFlags flags, bool regex,
+                   SearchIndex *index, int scan) :
+        text_ (text),
+        search_ (regex ? QString() : str, flags),
+        regex_ (regex ? RegexSearch (str, flags).regex() : QRegularExpression()),
+        isRegex_ (regex),
+        index_ (index),
+        scan_ (scan) {}
+
+    const QVector<int>& matches() const {
+        return matches_;
+    }
+    const QVector<int>& lengths() const {
+        return lengths_;
+    }
+    /* the index won't be informed of the progress anymore (it may be deleted) */
+    void detach() {
+        QMutexLocker locker (&mutex_);
+        index_ = nullptr;
+    }
+
+protected:
+    void run() {
+        if (isRegex_)
+        {
+            scanRegex();
+            return;
+        }
+        const int length = search_.length();
+        int from = 0;
+        while (from < text_.length())
+        { // search in chunks, to be interruptible
+            if (isInterruptionRequested())
+                return;
+            const int to = from + SCAN_CHUNK - 1;
+            int i = from;
+            while ((i = search_.indexIn (text_, i, to)) != -1)
+            {
+                matches_.append (i);
+                i += length;
+            }
+            from = qMax (to + 1, matches_.isEmpty() ? 0 : matches_.last() + length);
+            report();
+        }
+    }
+
+private:
+    /* the JIT-compiled regex is matched in the whole text, to support multiline
+       patterns, and the thread is interruptible between matches */
+    void scanRegex() {
+        if (!regex_.isValid()) return;
+        QRegularExpressionMatchIterator it = regex_.globalMatch (text_);
+        int next = SCAN_CHUNK;
+        while (it.hasNext())
+        {
+            if (isInterruptionRequested())
+                return;
+            QRegularExpressionMatch match = it.next();
+            if (match.capturedLength() == 0)
+                continue;
+            matches_.append (match.capturedStart());
+            lengths_.append (match.capturedLength());
+            if (match.capturedStart() >= next)
+            {
+                next = match.capturedStart() + SCAN_CHUNK;
+                report();
+            }
+        }
+    }
+
+    void report() {
+        QMutexLocker locker (&mutex_);
+        if (index_ != nullptr)
+        {
+            QMetaObject::invokeMethod (index_, "onScanProgress", Qt::QueuedConnection,
+                                       Q_ARG (int, scan_), Q_ARG (int, matches_.size()));
+        }
+    }
+
+    static const int SCAN_CHUNK = 1048576; // the number of possible match starts in each step
+
+    QString text_;
+    TextSearch search_;
+    QRegularExpression regex_;
+    bool isRegex_;
+    QVector<int> matches_;
+    QVector<int> lengths_;
+    SearchIndex *index_;
+    QMutex mutex_; // guards "index_"
+    int scan_;
+};
+
+static const int MAX_PATCH = 65536; // the maximum size of an edit that is searched in the GUI thread
+static const int REGEX_RESCAN_DELAY = 300; // the delay of searching a regex again after edits (in ms)
+
+SearchIndex::SearchIndex (TextEdit *textEdit) : QObject (textEdit)
+{
+    textEdit_ = textEdit;
+    flags_ = 0;
+    regex_ = false;
+    length_ = 0;
+    scanner_ = nullptr;
+    scanNumber_ = 0;
+    partialCount_ = 0;
+    ready_ = false;
+    stale_ = false;
+    timedOut_ = false;
+    rescanTimer_ = new QTimer (this);
+    rescanTimer_->setSingleShot (true);
+    rescanTimer_->setInterval (REGEX_RESCAN_DELAY);
+    connect (rescanTimer_, &QTimer::timeout, this, &SearchIndex::scan);
+    timeoutTimer_ = new QTimer (this);
+    timeoutTimer_->setSingleShot (true);
+    timeoutTimer_->setInterval (REGEX_TIMEOUT);
+    connect (timeoutTimer_, &QTimer::timeout, this, &SearchIndex::onTimeout);
+    connect (textEdit, &TextEdit::textEdited, this, &SearchIndex::onTextEdited);
+}
+/*************************/
+SearchIndex::~SearchIndex()
+{
+    stopScanning();
+}
+/*************************/
+// The scanner isn't waited for because a regex match may take long.
+// Its scan number is kept, so that its queued reports are ignored.
+void SearchIndex::stopScanning()
+{
+    timeoutTimer_->stop();
+    if (scanner_ == nullptr) return;
+    disconnect (scanner_, &QThread::finished, this, &SearchIndex::onScanned);
+    scanner_->detach();
+    abandoned_ = scanner_;
+    abandonWorker (scanner_);
+    scanner_ = nullptr;
+}
+/*************************/
+void SearchIndex::setQuery (const QString& str, QTextDocument::FindFlags flags, bool regex)
+{
+    flags &= QTextDocument::FindCaseSensitively | QTextDocument::FindWholeWords;
+    if (str == str_ && flags == flags_ && regex == regex_ && (ready_ || scanner_ != nullptr))
+        return;
+    str_ = str;
+    flags_ = flags;
+    regex_ = regex;
+    timedOut_ = false;
+    scan();
+}
+/*************************/
+void SearchIndex::scan()
+{
+    stopScanning();
+    rescanTimer_->stop();
+    matches_.clear();
+    lengths_.clear();
+    partialCount_ = 0;
+    ready_ = false;
+    stale_ = false;
+    if (str_.isEmpty())
+    {
+        length_ = 0;
+        emit countChanged();
+        return;
+    }
+    length_ = str_.length();
+    if (!abandoned_.isNull() && !abandoned_->isFinished())
+    { // don't let interrupted scanners pile up
+        connect (abandoned_.data(), &QThread::finished, this, &SearchIndex::scan, Qt::UniqueConnection);
+        emit countChanged();
+        return;
+    }
+    ++scanNumber_;
+    scanner_ = new SearchScanner (textEdit_->textSnapshot(), str_, flags_, regex_, this, scanNumber_);
+    connect (scanner_, &QThread::finished, this, &SearchIndex::onScanned);
+    scanner_->start();
+    if (regex_)
+        timeoutTimer_->start();
+    emit countChanged();
+}
+/*************************/
+void SearchIndex::onScanProgress (int scan, int count)
+{
+    if (scan != scanNumber_ || scanner_ == nullptr || stale_)
+        return;
+    partialCount_ = count;
+    emit countChanged();
+}
+/*************************/
+void SearchIndex::onTimeout()
+{
+    if (scanner_ == nullptr) return;
+    stopScanning();
+    timedOut_ = true;
+    partialCount_ = 0;
+    emit countChanged();
+}
+/*************************/
+void SearchIndex::onScanned()
+{
+    if (scanner_ == nullptr) return;
+    timeoutTimer_->stop();
+    scanner_->wait(); // "finished()" is emitted just before the thread finishes
+    if (stale_)
+    { // the text is edited in the meantime
+        scan();
+        return;
+    }
+    matches_ = scanner_->matches();
+    lengths_ = scanner_->lengths();
+    delete scanner_;
+    scanner_ = nullptr;
+    ready_ = true;
+    emit indexed();
+    emit countChanged();
+}
+/*************************/
+/*************************/
+void SearchIndex::onTextEdited (int position, int charsRemoved, int charsAdded)
+{
+    if (str_.isEmpty()) return;
+    if (regex_)
+    { // a regex can't be searched locally
+        const bool wasCounted = ready_ || scanner_ != nullptr;
+        stopScanning();
+        matches_.clear();
+        lengths_.clear();
+        partialCount_ = 0;
+        ready_ = false;
+        if (!timedOut_)
+            rescanTimer_->start();
+        if (wasCounted)
+            emit countChanged();
+        return;
+    }
+    if (scanner_ != nullptr)
+    {
+        stale_ = true;
+        return;
+    }
+    if (!ready_) return;
+    if (charsRemoved + charsAdded > MAX_PATCH)
+    {
+        scan();
+        return;
+    }
+
+    /* a match is kept if there's at least a character between it and the changed text
+       (for whole words); the matches after the changed text are moved */
+    QVector<int>::iterator first = std::lower_bound (matches_.begin(), matches_.end(), position - length_);
+    QVector<int>::iterator last = std::upper_bound (first, matches_.end(), position + charsRemoved);
+    QVector<int> next;
+    next.reserve (static_cast<int>(matches_.end() - last));
+    const int diff = charsAdded - charsRemoved;
+    for (QVector<int>::iterator it = last; it != matches_.end(); ++it)
+        next.append (*it + diff);
+    matches_.erase (first, matches_.end());
+
+    /* search again around the changed text, with a character before and after it */
+    int from = qMax (position - length_, 0);
+    if (!matches_.isEmpty())
+        from = qMax (from, matches_.last() + length_);
+    const int to = position + charsAdded; // the last start that may be new
+    const int textStart = qMax (from - 1, 0);
+    const int textEnd = qMin (to + length_ + 1, textEdit_->document()->characterCount() - 1);
+    if (from <= to && textStart < textEnd)
+    {
+        const QString text = textEdit_->textRange (textStart, textEnd);
+        TextSearch search (str_, flags_);
+        int i = from - textStart;
+        while ((i = search.indexIn (text, i, to - textStart)) != -1)
+        {
+            matches_.append (textStart + i);
+            i += length_;
+        }
+    }
+
+    /* the next matches shouldn't overlap the new ones */
+    int k = 0;
+    if (!matches_.isEmpty())
+    {
+        const int end = matches_.last() + length_;
+        while (k < next.size() && next.at (k) < end)
+            ++k;
+    }
+    for (; k < next.size(); ++k)
+        matches_.append (next.at (k));
+    emit countChanged();
+}
+
+}
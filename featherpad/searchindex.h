@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QObject>
+#include <QVector>
+#include <QTextDocument>
+#include <QTimer>
+#include <QPointer>
+#include <QThread>
+
+namespace FeatherPad {
+
+class TextEdit;
+class SearchScanner;
+
+/* The sorted starts of all matches of the searched text in a document.
+   The matches are found in a snapshot of the text by a worker thread, which
+   reports the number of matches found so far, and, when the text is edited,
+   only the part of the index around the edit is searched again. With a
+   self-overlapping string, the matches after an edit may differ from those
+   of a new search but they remain valid. Regex matches have different lengths
+   and can't be patched; the text is searched again when the typing pauses,
+   but not before the previous (interrupted) search has finished. A regex
+   search that takes too long is given up until the query is changed. */
+class SearchIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    SearchIndex (TextEdit *textEdit);
+    ~SearchIndex();
+
+    /* starts indexing (only the case sensitivity and whole words flags are considered,
+       and the latter is ignored with a regular expression) */
+    void setQuery (const QString& str, QTextDocument::FindFlags flags, bool regex = false);
+    QString query() const {
+        return str_;
+    }
+
+    /* whether the whole text is searched */
+    bool isIndexed() const {
+        return ready_;
+    }
+    /* the number of matches (or of those found until now, if the text is being searched) */
+    int count() const {
+        return ready_ ? matches_.size() : partialCount_;
+    }
+
+    /* whether the index is ready for the query */
+    bool isReady (const QString& str, QTextDocument::FindFlags flags, bool regex = false) const {
+        return ready_ && str == str_ && flags == flags_ && regex == regex_;
+    }
+    /* the length of the i-th match */
+    int matchLength (int i) const {
+        return regex_ ? lengths_.at (i) : length_;
+    }
+    const QVector<int>& matches() const {
+        return matches_;
+    }
+
+signals:
+    void indexed(); // emitted when the whole text is searched
+    void countChanged(); // emitted while searching too
+
+private slots:
+    void onScanned();
+    void onScanProgress (int scan, int count);
+    void onTextEdited (int position, int charsRemoved, int charsAdded);
+    void onTimeout();
+
+private:
+    void scan();
+    void stopScanning();
+
+    TextEdit *textEdit_;
+    QString str_;
+    QTextDocument::FindFlags flags_;
+    bool regex_;
+    int length_;
+    QVector<int> matches_;
+    QVector<int> lengths_; // only for a regex
+    SearchScanner *scanner_; // the worker thread
+    int scanNumber_; // for ignoring the progress of canceled scans
+    int partialCount_;
+    bool ready_;
+    bool stale_; // whether the text is edited while it's being searched
+    QTimer *rescanTimer_; // for searching a regex again after edits
+    QTimer *timeoutTimer_; // for giving up a regex search that takes too long
+    bool timedOut_;
+    QPointer<QThread> abandoned_; // the last interrupted scanner (if it's still running)
+};
+
+}
+
+#endif // SEARCHINDEX_H
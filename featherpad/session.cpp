@@ -222,6 +222,8 @@ void SessionDialog::openSessions()
             Config& config = static_cast<FPsingleton*>(qApp)->getConfig();
             int broken = 0;
             bool multiple (files.count() > 1 || win->isLoading());
+            bool lazy (files.count() > 1 && config.getLazyTabs());
+            bool firstLoaded (false);
             for (int i = 0; i < files.count(); ++i)
             {
                 if (!QFileInfo (files.at (i)).isFile())
@@ -232,9 +234,15 @@ void SessionDialog::openSessions()
                     ++broken;
                     continue;
                 }
-                win->newTabFromName (files.at (i),
-                                     true, // to save the cursor position
-                                     multiple);
+                if (lazy && firstLoaded)
+                    win->newLazyTab (files.at (i), true);
+                else
+                {
+                    win->newTabFromName (files.at (i),
+                                         true, // to save the cursor position
+                                         multiple);
+                    firstLoaded = true;
+                }
             }
             if (broken == files.count())
                 showPrompt (tr ("No file exists or can be opened."));
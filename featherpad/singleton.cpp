@@ -23,6 +23,8 @@
 #include <QFileInfo>
 #include <QStandardPaths>
 #include <QCryptographicHash>
+#include <QDateTime>
+#include <algorithm>
 #if defined Q_WS_X11 || defined Q_OS_LINUX || defined Q_OS_FREEBSD
 #include <QX11Info>
 #endif
@@ -45,6 +47,7 @@ FPsingleton::FPsingleton (int &argc, char **argv) : QApplication (argc, argv)
 #endif
 
     socketFailure_ = false;
+    memoryTimer_ = nullptr;
     config_.readConfig();
     lastFiles_ = config_.getLastFiles();
     if (config_.getIconless())
@@ -64,6 +67,10 @@ FPsingleton::FPsingleton (int &argc, char **argv) : QApplication (argc, argv)
     { // create a local server and listen to incomming messages from other instances
         localServer = new QLocalServer (this);
         connect (localServer, &QLocalServer::newConnection, this, &FPsingleton::receiveMessage);
+        /* release inactive documents if they use too much memory */
+        memoryTimer_ = new QTimer (this);
+        connect (memoryTimer_, &QTimer::timeout, this, &FPsingleton::manageMemory);
+        memoryTimer_->start (memoryCheckInterval);
         if (!localServer->listen (uniqueKey_))
         {
             if (localServer->removeServer (uniqueKey_))
@@ -153,8 +160,15 @@ FPwin* FPsingleton::newWin (const QString& message)
     else if (!lastFiles_.isEmpty())
     {
         bool multiple (lastFiles_.count() > 1 || fp->isLoading());
+        /* only the first file is loaded if restored files should be loaded lazily */
+        bool lazy (multiple && config_.getLazyTabs());
         for (int i = 0; i < lastFiles_.count(); ++i)
-            fp->newTabFromName (lastFiles_.at (i), false, multiple);
+        {
+            if (lazy && i > 0)
+                fp->newLazyTab (lastFiles_.at (i), false);
+            else
+                fp->newTabFromName (lastFiles_.at (i), false, multiple);
+        }
     }
 
     lastFiles_ = QStringList();
@@ -167,6 +181,54 @@ void FPsingleton::removeWin (FPwin *win)
     win->deleteLater();
 }
 /*************************/
+qint64 FPsingleton::documentMemory() const
+{
+    qint64 mem = 0;
+    for (int i = 0; i < Wins.count(); ++i)
+        mem += Wins.at (i)->documentMemory();
+    return mem;
+}
+/*************************/
+// If the documents of all windows use more memory than the budget, releases
+// the unmodified tabs that haven't been visited for a while, beginning
+// with the least recently visited one, until the budget isn't exceeded.
+void FPsingleton::manageMemory()
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 budget = static_cast<qint64>(config_.getMemoryBudget()) * 1024 * 1024;
+    qint64 idle = static_cast<qint64>(config_.getEvictionIdle()) * 60000;
+
+    struct idleTab {
+        FPwin *win;
+        TabPage *tabPage;
+        qint64 lastVisit;
+    };
+    QList<idleTab> tabs;
+    for (int i = 0; i < Wins.count(); ++i)
+    {
+        const QList<TabPage*> pages = Wins.at (i)->idleTabs (now, idle);
+        for (TabPage *tabPage : pages)
+            tabs.append ({Wins.at (i), tabPage, tabPage->textEdit()->getLastVisit()});
+    }
+
+    qint64 mem = documentMemory();
+    if (budget > 0 && mem > budget && !tabs.isEmpty())
+    {
+        std::sort (tabs.begin(), tabs.end(), [](const idleTab& a, const idleTab& b) {
+            return a.lastVisit < b.lastVisit;
+        });
+        for (int i = 0; i < tabs.count() && mem > budget; ++i)
+        {
+            qint64 tabMem = tabs.at (i).tabPage->textEdit()->residentMemory();
+            if (tabs.at (i).win->evictTab (tabs.at (i).tabPage))
+                mem -= tabMem;
+        }
+    }
+
+    for (int i = 0; i < Wins.count(); ++i)
+        Wins.at (i)->showDocMemory();
+}
+/*************************/
 void FPsingleton::handleMessage (const QString& message)
 {
     /* get all parts of the message */
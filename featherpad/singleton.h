@@ -23,6 +23,7 @@
 #include <QApplication>
 #include <QLocalServer>
 #include <QLockFile>
+#include <QTimer>
 #include "fpwin.h"
 #include "config.h"
 
@@ -39,6 +40,7 @@ public:
     bool sendMessage (const QString &message);
     FPwin* newWin (const QString &message);
     void removeWin (FPwin *win);
+    qint64 documentMemory() const;
 
     QList<FPwin*> Wins; // All FeatherPad windows.
 
@@ -52,6 +54,7 @@ public:
 public slots:
     void receiveMessage();
     void handleMessage (const QString& message);
+    void manageMemory();
     //void quitting();
 
 signals:
@@ -62,6 +65,8 @@ private:
     QLockFile *lockFile_;
     QLocalServer *localServer;
     static const int timeout = 1000;
+    static const int memoryCheckInterval = 30000; // in ms
+    QTimer *memoryTimer_; // Checks the memory used by documents.
     Config config_;
     QStringList lastFiles_;
     bool isX11_;
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#ifndef STREAMING_H
+#define STREAMING_H
+
+#include <QString>
+
+namespace FeatherPad {
+
+/* Finds where a chunk of a streamed text, which starts at "from" and
+   shouldn't go beyond "end", should end. If possible, the chunk ends right
+   after a line break, so that the next chunk starts a new line. Otherwise,
+   it isn't ended inside a surrogate pair or between '\r' and '\n' because
+   each of them would make a separate block break when inserted. */
+inline int streamingChunkEnd (const QString& text, int from, int end)
+{
+    if (end >= text.size())
+        return text.size();
+    int i = text.lastIndexOf (QLatin1Char ('\n'), end - 1);
+    if (i >= from)
+        return i + 1;
+    if (end - 1 > from
+        && (text.at (end - 1).isHighSurrogate()
+            || (text.at (end - 1) == QLatin1Char ('\r') && text.at (end) == QLatin1Char ('\n'))))
+    {
+        -- end;
+    }
+    return end;
+}
+
+}
+
+#endif // STREAMING_H
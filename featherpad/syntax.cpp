@@ -368,6 +368,8 @@ void FPwin::formatTextRect (QRect rect) const
             }
             block = block.next();
         }
+        /* prepare the formats of the surrounding text for scrolling */
+        highlighter->tokenizeAround (start.block(), end.block());
     }
 }
 
@@ -20,6 +20,8 @@
 #include <QGridLayout>
 #include "tabpage.h"
 #include "svgicons.h"
+#include "searchindex.h"
+#include <algorithm>
 
 namespace FeatherPad {
 
@@ -34,10 +36,11 @@ TabPage::TabPage (ICONMODE iconMode, int bgColorValue,
     QIcon icnNext, icnPrev;
     QIcon icnWhole = symbolicIcon::icon (":icons/whole.svg");
     QIcon icnCase = symbolicIcon::icon (":icons/case.svg");
+    QIcon icnRegex = symbolicIcon::icon (":icons/regex.svg");
     switch (iconMode) {
     case OWN:
         searchBar_->setSearchIcons (symbolicIcon::icon (":icons/go-down.svg"), symbolicIcon::icon (":icons/go-up.svg"),
-                                    icnWhole, icnCase);
+                                    icnWhole, icnCase, icnRegex);
         break;
     case SYSTEM:
         icnNext = QIcon::fromTheme ("go-down");
@@ -46,7 +49,7 @@ TabPage::TabPage (ICONMODE iconMode, int bgColorValue,
         icnPrev = QIcon::fromTheme ("go-up");
         if (icnPrev.isNull())
             icnPrev = QIcon (":icons/go-up.svg");
-        searchBar_->setSearchIcons (icnNext, icnPrev, icnWhole, icnCase);
+        searchBar_->setSearchIcons (icnNext, icnPrev, icnWhole, icnCase, icnRegex);
         break;
     case NONE:
     default:
@@ -62,6 +65,9 @@ TabPage::TabPage (ICONMODE iconMode, int bgColorValue,
 
     connect (searchBar_, &SearchBar::find, this, &TabPage::find);
     connect (searchBar_, &SearchBar::searchFlagChanged, this, &TabPage::searchFlagChanged);
+    /* show the number of matches and the position of the selected one among them */
+    connect (textEdit_->searchIndex(), &SearchIndex::countChanged, this, &TabPage::updateMatchCount);
+    connect (textEdit_, &QPlainTextEdit::selectionChanged, this, &TabPage::updateMatchCount);
 }
 /*************************/
 void TabPage::setSearchBarVisible (bool visible)
@@ -104,6 +110,41 @@ bool TabPage::matchWhole() const
     return searchBar_->matchWhole();
 }
 /*************************/
+bool TabPage::matchRegex() const
+{
+    return searchBar_->matchRegex();
+}
+/*************************/
+void TabPage::showSearchMessage (const QString& message)
+{
+    searchBar_->showMessage (message);
+}
+/*************************/
+void TabPage::updateMatchCount()
+{
+    SearchIndex *searchIndex = textEdit_->searchIndex();
+    if (searchIndex->query().isEmpty())
+    {
+        searchBar_->hideMatchCount();
+        return;
+    }
+    int k = 0;
+    QTextCursor cur = textEdit_->textCursor();
+    if (searchIndex->isIndexed() && cur.hasSelection())
+    {
+        const QVector<int> &matches = searchIndex->matches();
+        QVector<int>::const_iterator it = std::lower_bound (matches.constBegin(), matches.constEnd(),
+                                                            cur.selectionStart());
+        if (it != matches.constEnd() && *it == cur.selectionStart())
+        {
+            const int i = static_cast<int>(it - matches.constBegin());
+            if (cur.selectionEnd() - cur.selectionStart() == searchIndex->matchLength (i))
+                k = i + 1;
+        }
+    }
+    searchBar_->showMatchCount (k, searchIndex->count(), searchIndex->isIndexed());
+}
+/*************************/
 void TabPage::updateShortcuts (bool disable)
 {
     searchBar_->updateShortcuts (disable);
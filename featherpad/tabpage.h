@@ -49,6 +49,9 @@ public:
 
     bool matchCase() const;
     bool matchWhole() const;
+    bool matchRegex() const;
+
+    void showSearchMessage (const QString& message);
 
     void updateShortcuts (bool disable);
 
@@ -56,6 +59,9 @@ signals:
     void find (bool forward);
     void searchFlagChanged();
 
+private slots:
+    void updateMatchCount();
+
 private:
     QPointer<TextEdit> textEdit_;
     QPointer<SearchBar> searchBar_;
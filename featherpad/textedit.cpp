@@ -25,15 +25,24 @@
 #include <QDesktopServices>
 #include <QRegularExpression>
 #include <QClipboard>
+#include <algorithm>
 #include "textedit.h"
 #include "vscrollbar.h"
+#include "pagedfile.h"
+#include "regexps.h"
+#include "searchindex.h"
 
 #define UPDATE_INTERVAL 50 // in ms
 #define SCROLL_FRAMES_PER_SEC 60
 #define SCROLL_DURATION 300 // in ms
+#define BLOCK_OVERHEAD 160 // the approximate memory used by a block, its layout and data (in bytes)
+#define MATCH_DENSITY_PARTS 200 // the number of parts of the text whose search matches are shown on the scrollbar
 
 namespace FeatherPad {
 
+static const QRegularExpression spaceExp = precompiled ("\\s+"); // for indentation lines
+static const int MAX_SNAPSHOT_PATCH = 65536; // the maximum size of an edit that is copied into the snapshot
+
 TextEdit::TextEdit (QWidget *parent, int bgColorValue) : QPlainTextEdit (parent)
 {
     prevAnchor = prevPos = -1;
@@ -42,6 +51,9 @@ TextEdit::TextEdit (QWidget *parent, int bgColorValue) : QPlainTextEdit (parent)
     scrollJumpWorkaround = false;
     drawIndetLines = false;
     saveCursor_ = false;
+    lazy_ = false;
+    evictedPos_ = evictedAnchor_ = evictedScrollValue_ = -1;
+    lastVisit_ = 0;
     normalAsUrl_ = false;
     vLineDistance_ = 0;
 
@@ -120,11 +132,14 @@ TextEdit::TextEdit (QWidget *parent, int bgColorValue) : QPlainTextEdit (parent)
     encoding_= "UTF-8";
     uneditable_ = false;
     highlighter_ = nullptr;
+    firstLine_ = 0;
+    paging_ = false;
     setFrameShape (QFrame::NoFrame);
     /* first we replace the widget's vertical scrollbar with ours because
        we want faster wheel scrolling when the mouse cursor is on the scrollbar */
     VScrollBar *vScrollBar = new VScrollBar;
     setVerticalScrollBar (vScrollBar);
+    connect (vScrollBar, &QAbstractSlider::valueChanged, this, &TextEdit::onScrolling);
 
     lineNumberArea = new LineNumberArea (this);
     lineNumberArea->hide();
@@ -132,6 +147,29 @@ TextEdit::TextEdit (QWidget *parent, int bgColorValue) : QPlainTextEdit (parent)
     connect (this, &QPlainTextEdit::updateRequest, this, &TextEdit::onUpdateRequesting);
     connect (this, &QPlainTextEdit::cursorPositionChanged, this, &TextEdit::updateBracketMatching);
     connect (this, &QPlainTextEdit::selectionChanged, this, &TextEdit::onSelectionChanged);
+    /* the line index can't be used after the text is edited */
+    connect (document(), &QTextDocument::undoCommandAdded, this, [this]() {
+        lineIndex_.clear();
+    });
+    /* edits are distinguished from format changes, which change
+       the contents too but not the revision or length of the text;
+       a replacement of the whole text (by setPlainText(), which may
+       not change the revision) is always considered as an edit */
+    textRevision_ = document()->revision();
+    hasSnapshot_ = false;
+    connect (document(), &QTextDocument::contentsChange, this, [this](int position, int charsRemoved, int charsAdded) {
+        const int revision = document()->revision();
+        if (charsRemoved == charsAdded && revision == textRevision_
+            && (position > 0 || charsRemoved < document()->characterCount() - 1))
+        {
+            return;
+        }
+        textRevision_ = revision;
+        patchSnapshot (position, charsRemoved, charsAdded);
+        emit textEdited (position, charsRemoved, charsAdded);
+    });
+    searchIndex_ = new SearchIndex (this);
+    connect (searchIndex_, &SearchIndex::countChanged, this, &TextEdit::updateMatchDensity);
 
     setContextMenuPolicy (Qt::CustomContextMenu);
     connect (this, &QWidget::customContextMenuRequested, this, &TextEdit::showContextMenu);
@@ -194,7 +232,7 @@ void TextEdit::showLineNumbers (bool show)
 int TextEdit::lineNumberAreaWidth()
 {
     int digits = 1;
-    int max = qMax (1, blockCount());
+    int max = qMax (1, pagedFile_ ? pagedFile_->lineCount() : blockCount());
     while (max >= 10) {
         max /= 10;
         ++digits;
@@ -951,7 +989,7 @@ void TextEdit::paintEvent (QPaintEvent *event)
             if (drawIndetLines)
             {
                 QRegularExpressionMatch match;
-                if (block.text().indexOf (QRegularExpression ("\\s+"), 0, &match) == 0)
+                if (block.text().indexOf (spaceExp, 0, &match) == 0)
                 {
                     painter.save();
                     painter.setOpacity (0.18);
@@ -1071,7 +1109,7 @@ void TextEdit::lineNumberAreaPaintEvent (QPaintEvent *event)
     {
         if (block.isVisible() && bottom >= event->rect().top())
         {
-            QString number = QString::number (blockNumber + 1);
+            QString number = QString::number (firstLine_ + blockNumber + 1);
             painter.setPen (darkScheme ? Qt::black : Qt::white);
             painter.drawText (0, top, lineNumberArea->width() - 2, fontMetrics().height(),
                               Qt::AlignRight, number);
@@ -1084,6 +1122,192 @@ void TextEdit::lineNumberAreaPaintEvent (QPaintEvent *event)
     }
 }
 /*************************/
+void TextEdit::setPagedFile (const QSharedPointer<PagedFile>& pagedFile)
+{
+    if (pagedFile == pagedFile_) return;
+    pagedFile_ = pagedFile;
+    firstLine_ = 0;
+    if (!lineNumberArea->isHidden())
+        updateLineNumberAreaWidth (0);
+}
+/*************************/
+// Replaces the text with the page that starts with the given line but
+// keeps the cursor and the top visible line in place whenever possible.
+void TextEdit::setPage (int firstLine)
+{
+    if (pagedFile_.isNull()) return;
+    firstLine = qBound (0, firstLine, pagedFile_->lineCount() - 1);
+    if (firstLine == firstLine_) return;
+
+    QTextCursor cur = textCursor();
+    const int curLine = firstLine_ + cur.blockNumber();
+    const int curCol = cur.positionInBlock();
+    const int topLine = firstLine_ + firstVisibleBlock().blockNumber();
+
+    paging_ = true;
+    firstLine_ = firstLine;
+    setPlainText (pagedFile_->page (firstLine_));
+
+    QTextDocument *doc = document();
+    cur = QTextCursor (doc);
+    QTextBlock block = doc->findBlockByNumber (curLine - firstLine_);
+    if (block.isValid())
+        cur.setPosition (block.position() + qMin (curCol, block.length() - 1));
+    else if ((block = doc->findBlockByNumber (topLine - firstLine_)).isValid())
+        cur.setPosition (block.position());
+    setTextCursor (cur);
+    block = doc->findBlockByNumber (qMax (topLine - firstLine_, 0));
+    if (block.isValid())
+        verticalScrollBar()->setValue (block.firstLineNumber());
+    paging_ = false;
+
+    lineNumberArea->update();
+}
+/*************************/
+// Loads the page containing the line if it isn't in the current page.
+void TextEdit::loadLine (int line)
+{
+    if (pagedFile_.isNull()
+        || (line >= firstLine_ && line < firstLine_ + blockCount()))
+    {
+        return;
+    }
+    setPage (line - qMin (blockCount(), PagedFile::PAGE_LINES) / 2);
+    if (line >= firstLine_ + blockCount()) // the page has very long lines
+        setPage (line);
+}
+/*************************/
+// The number of lines in the file, even when the document has only
+// a part of it (as with a paged file or a text that is being streamed).
+int TextEdit::lineCount() const
+{
+    if (pagedFile_)
+        return pagedFile_->lineCount();
+    if (!lineIndex_.isEmpty())
+        return lineIndex_.lineCount();
+    return blockCount();
+}
+/*************************/
+// The position of the start of a line in the document, without
+// traversing the blocks when the line index can be used.
+int TextEdit::linePosition (int line) const
+{
+    if (line < 0) return 0;
+    if (line < lineIndex_.lineCount())
+        return qMin (lineIndex_.position (line), document()->characterCount() - 1);
+    QTextBlock block = document()->findBlockByNumber (line);
+    if (!block.isValid())
+        block = document()->lastBlock();
+    return block.position();
+}
+/*************************/
+// The text of a range of the document, as in its snapshot.
+QString TextEdit::textRange (int from, int to) const
+{
+    QTextBlock block = document()->findBlock (from);
+    const int start = block.position();
+    QString text;
+    while (block.isValid() && block.position() < to)
+    {
+        text += block.text();
+        block = block.next();
+        if (block.isValid())
+            text += QLatin1Char ('\n');
+    }
+    text.replace (QChar::Nbsp, QLatin1Char (' '));
+    text.replace (QChar::LineSeparator, QLatin1Char ('\n'));
+    return text.mid (from - start, to - from);
+}
+/*************************/
+// Puts a small edit into the snapshot instead of copying the whole text again.
+void TextEdit::patchSnapshot (int position, int charsRemoved, int charsAdded)
+{
+    if (!hasSnapshot_) return;
+    if (charsAdded > MAX_SNAPSHOT_PATCH || position + charsRemoved > snapshot_.length())
+    {
+        snapshot_.clear();
+        hasSnapshot_ = false;
+        return;
+    }
+    snapshot_.replace (position, charsRemoved, textRange (position, position + charsAdded));
+    if (snapshot_.length() != document()->characterCount() - 1)
+    { // the reported change isn't reliable (as with the last block)
+        snapshot_.clear();
+        hasSnapshot_ = false;
+    }
+}
+/*************************/
+const QString& TextEdit::textSnapshot()
+{
+    if (!hasSnapshot_)
+    {
+        snapshot_ = document()->toPlainText(); // nonbreaking spaces are converted to spaces
+        hasSnapshot_ = true;
+    }
+    return snapshot_;
+}
+/*************************/
+// Shows the density of search matches on the scrollbar. The parts of the text
+// have equal numbers of blocks, as the scrollbar range is made of blocks
+// (when lines aren't wrapped).
+void TextEdit::updateMatchDensity()
+{
+    VScrollBar *vScrollBar = qobject_cast<VScrollBar*>(verticalScrollBar());
+    if (vScrollBar == nullptr) return;
+    QVector<int> density;
+    if (searchIndex_->isIndexed() && searchIndex_->count() > 0)
+    {
+        const QVector<int> &matches = searchIndex_->matches();
+        const int blocks = blockCount();
+        const int parts = qMin (MATCH_DENSITY_PARTS, blocks);
+        density.reserve (parts);
+        QVector<int>::const_iterator it = matches.constBegin();
+        for (int i = 1; i <= parts; ++i)
+        {
+            QTextBlock block = document()->findBlockByNumber (static_cast<int>(static_cast<qint64>(blocks) * i / parts));
+            QVector<int>::const_iterator next = block.isValid()
+                                                    ? std::lower_bound (it, matches.constEnd(), block.position())
+                                                    : matches.constEnd();
+            density.append (static_cast<int>(next - it));
+            it = next;
+        }
+    }
+    vScrollBar->setMatchDensity (density);
+}
+/*************************/
+// A rough estimate of the memory used by the document (in bytes).
+// It's enough for comparing documents and deciding about eviction.
+qint64 TextEdit::residentMemory() const
+{
+    if (lazy_) return 0;
+    return static_cast<qint64>(document()->characterCount()) * static_cast<qint64>(sizeof (QChar))
+           + static_cast<qint64>(blockCount()) * BLOCK_OVERHEAD
+           + static_cast<qint64>(lineIndex_.lineCount()) * static_cast<qint64>(sizeof (int))
+           + static_cast<qint64>(snapshot_.length()) * static_cast<qint64>(sizeof (QChar));
+}
+/*************************/
+// Goes to the next or previous page when the scrollbar reaches its end or start.
+void TextEdit::onScrolling (int value)
+{
+    if (pagedFile_.isNull() || paging_) return;
+    QScrollBar *vScrollBar = verticalScrollBar();
+    if ((value == vScrollBar->maximum() && firstLine_ + blockCount() < pagedFile_->lineCount())
+        || (value == vScrollBar->minimum() && firstLine_ > 0))
+    {
+        /* wait until the scrolling is done */
+        QTimer::singleShot (0, this, [this]() {
+            if (pagedFile_.isNull()) return;
+            QScrollBar *vScrollBar = verticalScrollBar();
+            int v = vScrollBar->value();
+            if ((v == vScrollBar->maximum() && firstLine_ + blockCount() < pagedFile_->lineCount())
+                || (v == vScrollBar->minimum() && firstLine_ > 0))
+            { // put the visible lines in the middle of the new page
+                setPage (firstLine_ + firstVisibleBlock().blockNumber() - blockCount() / 2);
+            }
+        });
+    }
+}
+/*************************/
 // This calls the private function _q_adjustScrollbars()
 // by calling QPlainTextEdit::resizeEvent().
 void TextEdit::adjustScrollbars()
@@ -24,9 +24,14 @@
 #include <QMimeData>
 #include <QDateTime>
 #include <QSyntaxHighlighter>
+#include <QSharedPointer>
+#include "lineindex.h"
 
 namespace FeatherPad {
 
+class PagedFile;
+class SearchIndex;
+
 /* This is for auto-indentation, line numbers, DnD, zooming, customized
    vertical scrollbar, appropriate signals, and saving/getting useful info. */
 class TextEdit : public QPlainTextEdit
@@ -122,6 +127,17 @@ public:
         searchedText_ = text;
     }
 
+    /* a contiguous copy of the text for searching, which is made
+       when it's needed and patched with small edits afterward */
+    const QString& textSnapshot();
+    /* the text in [from, to), with the characters of the snapshot */
+    QString textRange (int from, int to) const;
+
+    /* the positions of all matches of the searched text */
+    SearchIndex *searchIndex() const {
+        return searchIndex_;
+    }
+
     QString getReplaceTitle() const {
         return replaceTitle_;
     }
@@ -205,6 +221,65 @@ public:
         saveCursor_ = save;
     }
 
+    /* a restored file isn't loaded before its tab is activated */
+    bool isLazy() const {
+        return lazy_;
+    }
+    void setLazy (bool lazy) {
+        lazy_ = lazy;
+        if (!lazy)
+            evictedPos_ = evictedAnchor_ = evictedScrollValue_ = -1;
+    }
+
+    /* the document of an inactive tab may be released, keeping only
+       the cursor and scrollbar positions, and will be reloaded later */
+    void setEvicted (int pos, int anchor, int scrollValue) {
+        lazy_ = true;
+        evictedPos_ = pos;
+        evictedAnchor_ = anchor;
+        evictedScrollValue_ = scrollValue;
+    }
+    bool isEvicted() const {
+        return (lazy_ && evictedPos_ > -1);
+    }
+    int getEvictedPos() const {
+        return evictedPos_;
+    }
+    int getEvictedAnchor() const {
+        return evictedAnchor_;
+    }
+    int getEvictedScrollValue() const {
+        return evictedScrollValue_;
+    }
+
+    /* the time (in ms since epoch) the tab was last visited */
+    qint64 getLastVisit() const {
+        return lastVisit_;
+    }
+    void setLastVisit (qint64 time) {
+        lastVisit_ = time;
+    }
+
+    qint64 residentMemory() const;
+
+    /* a huge file is shown page by page */
+    PagedFile *getPagedFile() const {
+        return pagedFile_.data();
+    }
+    void setPagedFile (const QSharedPointer<PagedFile>& pagedFile);
+    int getFirstLine() const {
+        return firstLine_;
+    }
+    void setPage (int firstLine);
+    void loadLine (int line);
+
+    /* the line index made while loading (until the text is edited) */
+    void setLineIndex (const LineIndex& lineIndex) {
+        lineIndex_ = lineIndex;
+    }
+    int lineCount() const;
+    int linePosition (int line) const;
+
 signals:
     /* inform the main widget */
     void fileDropped (const QString& localFile,
@@ -214,6 +289,8 @@ signals:
     void updateRect (const QRect &rect, int dy);
     void zoomedOut (TextEdit *textEdit); // needed for reformatting text
     void updateBracketMatching();
+    /* emitted when the text is edited (but not when only formats are changed) */
+    void textEdited (int position, int charsRemoved, int charsAdded);
 
 protected:
     void keyPressEvent (QKeyEvent *event);
@@ -258,10 +335,13 @@ private slots:
     void onSelectionChanged();
     void scrollWithInertia();
     void showContextMenu (const QPoint &p);
+    void onScrolling (int value);
+    void updateMatchDensity();
 
 private:
     QString computeIndentation (const QTextCursor &cur) const;
     QString getUrl (const int pos) const;
+    void patchSnapshot (int position, int charsRemoved, int charsAdded);
 
     int prevAnchor, prevPos; // used only for bracket matching
     QWidget *lineNumberArea;
@@ -285,6 +365,10 @@ private:
     QDateTime lastModified_; // the last modification time for knowing about changes.
     int wordNumber_; // the calculated number of words (-1 if not counted yet)
     QString searchedText_; // the text that is being searched in the documnet
+    QString snapshot_; // the text copied for searching
+    bool hasSnapshot_;
+    int textRevision_; // the document revision after the last edit
+    SearchIndex *searchIndex_;
     QString replaceTitle_; // the title of the Replacement dock (can change)
     QString fileName_; // opened file
     QString prog_; // programming language (for syntax highlighting)
@@ -302,6 +386,13 @@ private:
     bool uneditable_; // the doc should be made uneditable because of its contents
     QSyntaxHighlighter *highlighter_; // syntax highlighter
     bool saveCursor_;
+    bool lazy_; // the file name is set but the file isn't loaded yet
+    int evictedPos_, evictedAnchor_, evictedScrollValue_; // -1 if not evicted
+    qint64 lastVisit_;
+    QSharedPointer<PagedFile> pagedFile_; // the huge file that is shown page by page (if any)
+    int firstLine_; // the number of the first line of the page in the file
+    bool paging_;
+    LineIndex lineIndex_; // the line starts of the loaded text
     /******************************
      ***** Inertial scrolling *****
      ******************************/
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+#ifndef TEXTSEARCH_H
+#define TEXTSEARCH_H
+
+#include <QTextDocument>
+
+namespace FeatherPad {
+
+/* A literal search in a contiguous text (usually, a snapshot of a document),
+   using the Boyer-Moore-Horspool algorithm in both directions (but a short
+   case-sensitive string is found forward by a vector scan for its last
+   character, with a Horspool shift after each candidate). Characters are
+   case-folded by a table when the search is case-insensitive, and matches that
+   aren't whole words are filtered out if needed. Since the text is contiguous,
+   a string with line breaks is searched like any other string. */
+class TextSearch
+{
+public:
+    TextSearch (const QString& str, Qt::CaseSensitivity cs, bool wholeWords);
+    /* only the case sensitivity and whole words flags are considered */
+    TextSearch (const QString& str, QTextDocument::FindFlags flags);
+
+    int length() const {
+        return needle_.length();
+    }
+
+    /* the start of the first match that starts at or after "from" and,
+       if "to" isn't negative, at or before "to" (-1 if none) */
+    int indexIn (const QString& text, int from, int to = -1) const;
+    /* the start of the last match that starts at or before "from" (-1 if none) */
+    int lastIndexIn (const QString& text, int from) const;
+
+private:
+    bool matchesAt (const ushort *text, int pos) const;
+    bool isWholeWord (const QString& text, int pos) const;
+
+    QString needle_; // case-folded if the search is case-insensitive
+    const ushort *fold_; // the case-folding table (null if the search is case-sensitive)
+    bool wholeWords_;
+    int skip_[256]; // the forward shifts, by the low byte of the last character of the window
+    int backSkip_[256]; // the backward shifts, by the low byte of its first character
+};
+
+}
+
+#endif // TEXTSEARCH_H
@@ -20,6 +20,8 @@
 #include "vscrollbar.h"
 #include <QEvent>
 #include <QApplication>
+#include <QPainter>
+#include <QStyleOptionSlider>
 
 namespace FeatherPad {
 
@@ -45,5 +47,45 @@ bool VScrollBar::event (QEvent *event)
 
     return QScrollBar::event (event);
 }
+/*************************/
+void VScrollBar::setMatchDensity (const QVector<int> &density)
+{
+    if (density == matchDensity) return;
+    matchDensity = density;
+    update();
+}
+/*************************/
+void VScrollBar::paintEvent (QPaintEvent *event)
+{
+    QScrollBar::paintEvent (event);
+    if (matchDensity.isEmpty()) return;
+
+    QStyleOptionSlider opt;
+    initStyleOption (&opt);
+    QRect groove = style()->subControlRect (QStyle::CC_ScrollBar, &opt, QStyle::SC_ScrollBarGroove, this);
+    if (groove.height() <= 0) return;
+
+    int max = 0;
+    for (const int n : static_cast<const QVector<int>&>(matchDensity))
+        max = qMax (max, n);
+    if (max == 0) return;
+
+    /* draw a mark for each part with matches, more opaque with more matches,
+       on a strip at the right side of the groove (not to hide the handle) */
+    QPainter painter (this);
+    QColor color = palette().color (QPalette::Highlight);
+    const int parts = matchDensity.size();
+    const int markHeight = qMax (groove.height() / parts, 2);
+    const int markWidth = qMax (groove.width() / 3, 2);
+    for (int i = 0; i < parts; ++i)
+    {
+        const int n = matchDensity.at (i);
+        if (n == 0) continue;
+        color.setAlphaF (0.4 + 0.6 * static_cast<qreal>(n) / static_cast<qreal>(max));
+        painter.fillRect (QRect (groove.right() - markWidth + 1, groove.top() + groove.height() * i / parts,
+                                 markWidth, markHeight),
+                          color);
+    }
+}
 
 }
@@ -21,22 +21,28 @@
 #define VSCROLLBAR_H
 
 #include <QScrollBar>
+#include <QVector>
 
 namespace FeatherPad {
 
-/* We want faster mouse wheel scrolling
-   when the mouse cursor is on the scrollbar. */
+/* We want faster mouse wheel scrolling when the mouse cursor
+   is on the scrollbar. The density of search matches in equal
+   parts of the text can also be shown on the groove. */
 class VScrollBar : public QScrollBar
 {
     Q_OBJECT
 public:
     VScrollBar (QWidget *parent = 0);
 
+    void setMatchDensity (const QVector<int> &density);
+
 protected:
     bool event (QEvent *event);
+    void paintEvent (QPaintEvent *event);
 
 private:
     int defaultWheelSpeed;
+    QVector<int> matchDensity; // the numbers of matches in equal parts of the text
 };
 
 }
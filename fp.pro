@@ -1,5 +1,11 @@
 SUBDIRS += featherpad
 
+# the highlighting benchmark is built only with "qmake CONFIG+=benchmark"
+benchmark: SUBDIRS += benchmark
+
+# the tests are built only with "qmake CONFIG+=tests"
+tests: SUBDIRS += tests/streaming
+
 TEMPLATE = subdirs 
 
 CONFIG += qt \
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) Pedram Pourang (aka Tsu Jan) 2014 <tsujan2000@gmail.com>
+ *
+ * FeatherPad is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * FeatherPad is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @license GPL-3.0+ <https://spdx.org/licenses/GPL-3.0+.html>
+ */
+
+/* Streams texts into documents chunk by chunk, as FPwin does with huge
+   texts, and checks that the documents have the same blocks as when the
+   whole texts are set at once. Returns a nonzero value on failure.
+
+   Usage: featherpad-test-streaming */
+
+#include <QGuiApplication>
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QTextStream>
+#include "streaming.h"
+
+using namespace FeatherPad;
+
+static bool check (const QString& name, const QString& text, int chunkSize)
+{
+    QTextDocument whole;
+    whole.setPlainText (text);
+
+    QTextDocument streamed;
+    int pos = streamingChunkEnd (text, 0, chunkSize);
+    streamed.setPlainText (text.left (pos));
+    QTextCursor cur (&streamed);
+    while (pos < text.size())
+    {
+        int end = streamingChunkEnd (text, pos, pos + chunkSize);
+        cur.movePosition (QTextCursor::End);
+        cur.insertText (text.mid (pos, end - pos));
+        pos = end;
+    }
+
+    QTextStream out (stdout);
+    if (streamed.blockCount() != whole.blockCount()
+        || streamed.toPlainText() != whole.toPlainText())
+    {
+        out << "FAIL " << name << ": " << streamed.blockCount()
+            << " blocks instead of " << whole.blockCount() << endl;
+        return false;
+    }
+    out << "PASS " << name << endl;
+    return true;
+}
+
+int main (int argc, char **argv)
+{
+    QGuiApplication app (argc, argv);
+
+    QString lf, crlf, longLines, surrogates;
+    for (int i = 0; i < 1000; ++i)
+    {
+        const QString line = QString ("line %1 of the text").arg (i);
+        lf += line + "\n";
+        crlf += line + "\r\n";
+        longLines += line.repeated (20) + "\r\n";
+        surrogates += QString::fromUtf8 ("\xF0\x9F\x98\x80").repeated (7) + "\r\n";
+    }
+
+    bool ok = true;
+    /* chunk sizes that end chunks at every position of a line */
+    for (int size = 7; size <= 64; ++size)
+    {
+        ok = check (QString ("LF, chunks of %1").arg (size), lf, size) && ok;
+        ok = check (QString ("CRLF, chunks of %1").arg (size), crlf, size) && ok;
+        ok = check (QString ("long CRLF lines, chunks of %1").arg (size), longLines, size) && ok;
+        ok = check (QString ("surrogates, chunks of %1").arg (size), surrogates, size) && ok;
+    }
+    return ok ? 0 : 1;
+}
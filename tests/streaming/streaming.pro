@@ -0,0 +1,15 @@
+# A test of streaming huge texts into documents. It isn't built by default;
+# use "qmake CONFIG+=tests" in the top directory to build it with FeatherPad.
+
+QT += core gui
+
+TARGET = featherpad-test-streaming
+TEMPLATE = app
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../../featherpad
+
+SOURCES += streaming.cpp
+
+HEADERS += ../../featherpad/streaming.h